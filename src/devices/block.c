@@ -3,7 +3,9 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/vaddr.h"
 
 /* A block device. */
 struct block
@@ -19,6 +21,7 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    unsigned long long request_cnt;     /* Number of driver requests. */
   };
 
 /* List of all block devices. */
@@ -120,9 +123,7 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  block_read_multiple (block, sector, 1, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +134,157 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
-  check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  block_write_multiple (block, sector, 1, buffer);
+}
+
+/* Reads CNT consecutive sectors, starting at SECTOR, from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  If the driver supports it, the sectors are read with
+   a single request.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  struct block_request req;
+
+  if (cnt == 0)
+    return;
+  block_request_init (&req, false, sector, cnt, buffer, NULL, NULL);
+  block_submit (block, &req);
+  block_wait (&req);
+}
+
+/* Writes CNT consecutive sectors, starting at SECTOR, to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   If the driver supports it, the sectors are written with a
+   single request.  Returns after the block device has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      size_t cnt, const void *buffer)
+{
+  struct block_request req;
+
+  if (cnt == 0)
+    return;
+  block_request_init (&req, true, sector, cnt, (void *) buffer, NULL, NULL);
+  block_submit (block, &req);
+  block_wait (&req);
+}
+
+/* Initializes REQ to read (if WRITE is false) or write CNT
+   sectors, starting at SECTOR, into or from BUFFER, which must
+   have room for CNT * BLOCK_SECTOR_SIZE bytes.  BUFFER must be
+   in kernel memory, since drivers may move the data by DMA or
+   from an interrupt handler.  If COMPLETE is non-null, it is
+   called with REQ and AUX when the request completes, possibly
+   from an interrupt handler. */
+void
+block_request_init (struct block_request *req, bool write,
+                    block_sector_t sector, size_t cnt, void *buffer,
+                    block_complete_func *complete, void *aux)
+{
+  req->write = write;
+  req->sector = sector;
+  req->cnt = cnt;
+  req->buffer = buffer;
+  req->complete = complete;
+  req->aux = aux;
+  req->driver = NULL;
+  sema_init (&req->done, 0);
+}
+
+/* Carries out REQ on BLOCK synchronously, for a driver that
+   cannot queue requests.  Returns the number of driver calls
+   made. */
+static size_t
+transfer_sync (struct block *block, struct block_request *req)
+{
+  const struct block_operations *ops = block->ops;
+  uint8_t *buffer = req->buffer;
+  size_t i;
+
+  if (req->write && ops->write_multiple != NULL)
+    ops->write_multiple (block->aux, req->sector, req->cnt, buffer);
+  else if (!req->write && ops->read_multiple != NULL)
+    ops->read_multiple (block->aux, req->sector, req->cnt, buffer);
+  else
+    {
+      for (i = 0; i < req->cnt; i++, buffer += BLOCK_SECTOR_SIZE)
+        if (req->write)
+          ops->write (block->aux, req->sector + i, buffer);
+        else
+          ops->read (block->aux, req->sector + i, buffer);
+      return req->cnt;
+    }
+  return 1;
+}
+
+/* Starts REQ, which must have been initialized with
+   block_request_init(), on BLOCK and returns without waiting for
+   it to complete, if the driver allows.  The caller must not
+   touch REQ again until it completes.
+   Requests may be carried out in any order.  Internally
+   synchronizes accesses to block devices, so external per-block
+   device locking is unneeded. */
+void
+block_submit (struct block *block, struct block_request *req)
+{
+  enum intr_level old_level;
+  size_t request_cnt;
+
+  ASSERT (req->cnt > 0);
+  ASSERT (is_kernel_vaddr (req->buffer));
+  ASSERT (!req->write || block->type != BLOCK_FOREIGN);
+  check_sector (block, req->sector);
+  check_sector (block, req->sector + req->cnt - 1);
+
+  /* Readers do not serialize on filesys_lock, so several threads
+     may submit requests to BLOCK at once. */
+  old_level = intr_disable ();
+  if (req->write)
+    block->write_cnt += req->cnt;
+  else
+    block->read_cnt += req->cnt;
+  intr_set_level (old_level);
+
+  if (block->ops->submit != NULL)
+    {
+      request_cnt = 1;
+      block->ops->submit (block->aux, req);
+    }
+  else
+    {
+      request_cnt = transfer_sync (block, req);
+      block_complete (req);
+    }
+
+  old_level = intr_disable ();
+  block->request_cnt += request_cnt;
+  intr_set_level (old_level);
+}
+
+/* Waits for REQ, submitted with block_submit(), to complete. */
+void
+block_wait (struct block_request *req)
+{
+  sema_down (&req->done);
+}
+
+/* Marks REQ complete.  Called by a block driver, possibly from
+   an interrupt handler, once REQ's data has been transferred.
+   Calls REQ's completion function, if any, then wakes up any
+   thread waiting for it. */
+void
+block_complete (struct block_request *req)
+{
+  if (req->complete != NULL)
+    req->complete (req, req->aux);
+  sema_up (&req->done);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -171,9 +319,9 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
-          printf ("%s (%s): %llu reads, %llu writes\n",
+          printf ("%s (%s): %llu reads, %llu writes, %llu requests\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  block->read_cnt, block->write_cnt, block->request_cnt);
         }
     }
 }
@@ -200,6 +348,7 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->request_cnt = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -1,8 +1,11 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include <list.h>
+#include "threads/synch.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,9 +56,43 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multiple (struct block *, block_sector_t, size_t cnt,
+                          void *);
+void block_write_multiple (struct block *, block_sector_t, size_t cnt,
+                           const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests. */
+struct block_request;
+typedef void block_complete_func (struct block_request *, void *aux);
+
+/* A request to transfer a run of sectors.  Initialize it with
+   block_request_init(), start it with block_submit(), and
+   either wait for it with block_wait() or be told of its
+   completion through its completion function. */
+struct block_request
+  {
+    bool write;                 /* Write (true) or read (false)? */
+    block_sector_t sector;      /* First sector, possibly remapped by
+                                   drivers, such as partitions. */
+    size_t cnt;                 /* Number of sectors. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    block_complete_func *complete;  /* Called on completion, or null. */
+    void *aux;                  /* Passed to COMPLETE. */
+
+    /* Owned by the block layer and drivers. */
+    struct list_elem elem;      /* Element in a driver's queue. */
+    void *driver;               /* Driver's data. */
+    struct semaphore done;      /* Up'd on completion. */
+  };
+
+void block_request_init (struct block_request *, bool write,
+                         block_sector_t, size_t cnt, void *buffer,
+                         block_complete_func *, void *aux);
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+
 /* Statistics. */
 void block_print_stats (void);
 
@@ -65,10 +102,26 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Transfer CNT consecutive sectors as a single request.  A
+       driver that cannot do better than one sector at a time
+       may leave these null. */
+    void (*read_multiple) (void *aux, block_sector_t, size_t cnt,
+                           void *buffer);
+    void (*write_multiple) (void *aux, block_sector_t, size_t cnt,
+                            const void *buffer);
+
+    /* Starts a request and returns without waiting for it.  The
+       driver calls block_complete() when the request is done.
+       A driver that provides this need not provide the
+       synchronous operations above, which are used only in its
+       absence. */
+    void (*submit) (void *aux, struct block_request *);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+void block_complete (struct block_request *);
 
 #endif /* devices/block.h */
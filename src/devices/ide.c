@@ -1,6 +1,7 @@
 #include "devices/ide.h"
 #include <ctype.h>
 #include <debug.h>
+#include <list.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "devices/block.h"
@@ -8,7 +9,9 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -34,6 +37,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +53,42 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Bus master IDE port addresses, relative to the channel's
+   BM_BASE.  See [BMIDE]. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0)  /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)   /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)     /* PRDT address. */
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer into memory, i.e. disk read. */
+
+/* Bus master Status Register bits.  The interrupt and error bits
+   are cleared by writing 1s to them. */
+#define BM_STA_ACTIVE 0x01      /* Transfer in progress. */
+#define BM_STA_ERR 0x02         /* Transfer failed. */
+#define BM_STA_INTR 0x04        /* Device interrupted. */
+
+/* A physical region descriptor, one entry in the table that
+   tells the bus master where in memory to move data.  A region
+   may not cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical base address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT in the last entry. */
+  };
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Most sectors that one command can transfer.  A sector count
+   of 0 in the Sector Count register means 256. */
+#define MAX_COMMAND_SECTORS 256
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +97,9 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple_cnt;           /* Sectors per READ/WRITE MULTIPLE
+                                   block, or 0 if not enabled. */
+    bool dma;                   /* Transfer by bus master DMA? */
   };
 
 /* An ATA channel (aka controller).
@@ -66,11 +109,26 @@ struct channel
     char name[8];               /* Name, e.g. "ide0". */
     uint16_t reg_base;          /* Base I/O port. */
     uint8_t irq;                /* Interrupt in use. */
+    uint16_t bm_base;           /* Bus master base port, or 0 if the
+                                   controller cannot do DMA. */
+    struct prd *prdt;           /* Physical region descriptor table. */
 
-    struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
-    struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct semaphore completion_wait;   /* Up'd by interrupt handler for
+                                           commands outside the queue. */
+
+    /* Request queue.  Served in the interrupt handler, so
+       protected by disabling interrupts. */
+    struct list queue;          /* Waiting block requests. */
+    block_sector_t head;        /* Sector just past the last transfer. */
+    struct block_request *active;   /* Request in progress, or null. */
+    block_sector_t xfer_sector; /* Next sector of ACTIVE to command. */
+    size_t xfer_left;           /* Sectors of ACTIVE not yet commanded. */
+    uint8_t *xfer_buffer;       /* Data for the next sector transferred. */
+    size_t cmd_left;            /* Sectors left in the current command,
+                                   for PIO. */
+    bool cmd_dma;               /* Current command uses DMA? */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -81,17 +139,27 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+static uint16_t find_bus_master (void);
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static bool set_multiple_mode (struct ata_disk *, int cnt);
+
+static void start_request (struct channel *);
+static void start_command (struct channel *);
+static void start_dma (struct channel *, bool write, size_t cnt);
+static void finish_dma (struct channel *);
+static void transfer_block (struct channel *);
+static void service_request (struct channel *, uint8_t status);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sectors (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
+static bool wait_for_drq (const struct ata_disk *);
 static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
@@ -101,6 +169,7 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void) 
 {
+  uint16_t bm_base = find_bus_master ();
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -123,9 +192,23 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
+      if (bm_base != 0) 
+        {
+          /* The table lies within one page, so it cannot cross a
+             64 kB boundary, as the bus master requires. */
+          c->bm_base = bm_base + chan_no * 8;
+          c->prdt = palloc_get_page (PAL_ASSERT);
+        }
+      else 
+        {
+          c->bm_base = 0;
+          c->prdt = NULL;
+        }
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      list_init (&c->queue);
+      c->head = 0;
+      c->active = NULL;
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +219,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple_cnt = 0;
+          d->dma = false;
         }
 
       /* Register interrupt handler. */
@@ -159,6 +244,68 @@ ide_init (void)
 
 static char *descramble_ata_string (char *, int size);
 
+/* PCI configuration space access ports. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Returns the 32-bit PCI configuration register at byte offset
+   REG of function FUNC of device DEV on PCI bus 0. */
+static uint32_t
+pci_config_read (int dev, int func, int reg) 
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Sets the 32-bit PCI configuration register at byte offset REG
+   of function FUNC of device DEV on PCI bus 0 to VALUE. */
+static void
+pci_config_write (int dev, int func, int reg, uint32_t value) 
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for an IDE controller capable of bus
+   mastering, such as the PIIX found in most PCs and emulators.
+   If there is one, turns on its bus mastering and returns the
+   base of its bus master I/O ports, the first 8 for the primary
+   channel and the second 8 for the secondary.  Otherwise,
+   returns 0 and we stick to PIO. */
+static uint16_t
+find_bus_master (void) 
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++) 
+      {
+        uint32_t class = pci_config_read (dev, func, 0x08) >> 8;
+        uint32_t bar4;
+
+        if ((pci_config_read (dev, func, 0x00) & 0xffff) == 0xffff)
+          continue;
+
+        /* Mass storage controller, IDE, with bit 7 of the
+           programming interface saying it can bus master. */
+        if ((class >> 8) != 0x0101 || (class & 0x80) == 0)
+          continue;
+
+        /* BAR4 is the bus master base, which must be in I/O
+           space. */
+        bar4 = pci_config_read (dev, func, 0x20);
+        if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space and bus master in the Command
+           register. */
+        pci_config_write (dev, func, 0x04,
+                          pci_config_read (dev, func, 0x04) | 0x05);
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
 /* Resets an ATA channel and waits for any devices present on it
    to finish the reset. */
 static void
@@ -262,6 +409,7 @@ identify_ata_device (struct ata_disk *d)
   struct channel *c = d->channel;
   char id[BLOCK_SECTOR_SIZE];
   block_sector_t capacity;
+  int max_multiple;
   char *model, *serial;
   char extra_info[128];
   struct block *block;
@@ -279,7 +427,20 @@ identify_ata_device (struct ata_disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
+
+  /* Enable READ MULTIPLE and WRITE MULTIPLE with the largest
+     block the disk allows, given in the low byte of word 47, so
+     that a multi-sector transfer interrupts once per block
+     instead of once per sector. */
+  max_multiple = id[47 * 2] & 0xff;
+  if (max_multiple > 0 && set_multiple_mode (d, max_multiple))
+    d->multiple_cnt = max_multiple;
+
+  /* Use DMA if both the controller and the disk can, the latter
+     shown by bit 8 of word 49.  We leave the disk in whatever
+     DMA mode the firmware chose. */
+  d->dma = c->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -287,7 +448,8 @@ identify_ata_device (struct ata_disk *d)
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
   snprintf (extra_info, sizeof extra_info,
-            "model \"%s\", serial \"%s\"", model, serial);
+            "model \"%s\", serial \"%s\"%s", model, serial,
+            d->dma ? ", DMA" : "");
 
   /* Disable access to IDE disks over 1 GB, which are likely
      physical IDE disks rather than virtual ones.  If we don't
@@ -309,6 +471,22 @@ identify_ata_device (struct ata_disk *d)
   partition_scan (block);
 }
 
+/* Sets the number of sectors that disk D transfers per block in
+   READ MULTIPLE and WRITE MULTIPLE commands to CNT.  Returns
+   true if successful, false if D rejected the command. */
+static bool
+set_multiple_mode (struct ata_disk *d, int cnt) 
+{
+  struct channel *c = d->channel;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), cnt);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  return (inb (reg_status (c)) & STA_ERR) == 0;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -337,63 +515,254 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
-   Internally synchronizes accesses to disks, so external
-   per-disk locking is unneeded. */
+/* Starts request REQ on disk D.  Requests wait in the queue of
+   D's channel until the channel is free, and are then carried
+   out one at a time by the interrupt handler.  REQ's buffer must
+   be in kernel memory, since the transfer may finish while any
+   process is running. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_submit (void *d_, struct block_request *req)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  lock_release (&c->lock);
-}
+  enum intr_level old_level;
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
-   Internally synchronizes accesses to disks, so external
-   per-disk locking is unneeded. */
-static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
-{
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  req->driver = d;
+
+  old_level = intr_disable ();
+  list_push_back (&c->queue, &req->elem);
+  if (c->active == NULL)
+    start_request (c);
+  intr_set_level (old_level);
 }
 
 static struct block_operations ide_operations =
   {
-    ide_read,
-    ide_write
+    .submit = ide_submit
   };
-
+
+/* Removes and returns the request in channel C's queue to serve
+   next, chosen C-LOOK style: the request at the lowest sector at
+   or beyond the head's position, or if there is none, the one at
+   the lowest sector overall.  The head thus sweeps upward across
+   the disk, serving requests in passing, and then jumps back to
+   the lowest.  (Both disks on a channel share one sweep, which
+   is good enough for us.) */
+static struct block_request *
+next_request (struct channel *c) 
+{
+  struct block_request *next = NULL, *lowest = NULL;
+  struct list_elem *e;
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e)) 
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      if (lowest == NULL || r->sector < lowest->sector)
+        lowest = r;
+      if (r->sector >= c->head && (next == NULL || r->sector < next->sector))
+        next = r;
+    }
+  if (next == NULL)
+    next = lowest;
+
+  list_remove (&next->elem);
+  return next;
+}
+
+/* Makes the next request in channel C's queue, which must not be
+   empty, active and starts its first command.  Must be called
+   with interrupts off. */
+static void
+start_request (struct channel *c) 
+{
+  struct block_request *r;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (c->active == NULL);
+
+  r = c->active = next_request (c);
+  c->xfer_sector = r->sector;
+  c->xfer_left = r->cnt;
+  c->xfer_buffer = r->buffer;
+  start_command (c);
+}
+
+/* Issues a command for up to MAX_COMMAND_SECTORS of the sectors
+   of channel C's active request not yet commanded.  Uses DMA if
+   the disk supports it and the buffer is 2-byte aligned, as a
+   PRD's address must be, and otherwise READ or WRITE MULTIPLE if
+   the disk supports that.  For a PIO write, also sends the first
+   block of data, since the disk does not interrupt to ask for
+   it. */
+static void
+start_command (struct channel *c) 
+{
+  struct block_request *r = c->active;
+  struct ata_disk *d = r->driver;
+  size_t cmd_cnt = (c->xfer_left < MAX_COMMAND_SECTORS
+                    ? c->xfer_left : MAX_COMMAND_SECTORS);
+  uint8_t command;
+
+  select_sectors (d, c->xfer_sector, cmd_cnt);
+  c->xfer_sector += cmd_cnt;
+  c->xfer_left -= cmd_cnt;
+
+  if (d->dma && ((uintptr_t) c->xfer_buffer & 1) == 0) 
+    {
+      start_dma (c, r->write, cmd_cnt);
+      return;
+    }
+
+  c->cmd_dma = false;
+  c->cmd_left = cmd_cnt;
+
+  if (r->write)
+    command = (d->multiple_cnt > 0
+               ? CMD_WRITE_MULTIPLE : CMD_WRITE_SECTOR_RETRY);
+  else
+    command = (d->multiple_cnt > 0
+               ? CMD_READ_MULTIPLE : CMD_READ_SECTOR_RETRY);
+  issue_pio_command (c, command);
+
+  if (r->write) 
+    {
+      if (!wait_for_drq (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu,
+               d->name, c->xfer_sector - cmd_cnt);
+      transfer_block (c);
+    }
+}
+
+/* Has channel C's bus master move CNT sectors between the disk
+   and the active request's buffer, which must be in kernel
+   memory, and issues the READ DMA or WRITE DMA command for them.
+   The disk's sectors must already be selected.  The CPU is not
+   involved again until the interrupt that marks the end of the
+   whole transfer. */
+static void
+start_dma (struct channel *c, bool write, size_t cnt) 
+{
+  uint32_t addr = vtop (c->xfer_buffer);
+  size_t left = cnt * BLOCK_SECTOR_SIZE;
+  struct prd *prd = c->prdt;
+
+  /* Describe the buffer, which is contiguous in physical memory
+     because kernel memory is, in regions that do not cross
+     64 kB boundaries. */
+  while (left > 0) 
+    {
+      size_t boundary_left = 0x10000 - (addr & 0xffff);
+      size_t size = left < boundary_left ? left : boundary_left;
+
+      prd->addr = addr;
+      prd->size = size & 0xffff;
+      prd->flags = 0;
+      addr += size;
+      left -= size;
+      prd++;
+    }
+  prd[-1].flags = PRD_EOT;
+  c->xfer_buffer += cnt * BLOCK_SECTOR_SIZE;
+  c->cmd_dma = true;
+  c->cmd_left = 0;
+
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), write ? 0 : BM_CMD_READ);
+  outb (reg_bm_status (c), BM_STA_ERR | BM_STA_INTR);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), (write ? 0 : BM_CMD_READ) | BM_CMD_START);
+}
+
+/* Stops channel C's bus master at the end of a DMA command and
+   panics if it reports an error. */
+static void
+finish_dma (struct channel *c) 
+{
+  uint8_t status = inb (reg_bm_status (c));
+
+  outb (reg_bm_command (c), 0);
+  outb (reg_bm_status (c), BM_STA_ERR | BM_STA_INTR);
+  if (status & BM_STA_ERR)
+    PANIC ("%s: DMA transfer failed", c->name);
+}
+
+/* Transfers the next block of the current command on channel C,
+   that is, up to one READ/WRITE MULTIPLE block or else a single
+   sector, through the data register. */
+static void
+transfer_block (struct channel *c) 
+{
+  struct block_request *r = c->active;
+  struct ata_disk *d = r->driver;
+  size_t block_cnt = d->multiple_cnt > 0 ? (size_t) d->multiple_cnt : 1;
+  size_t cnt = c->cmd_left < block_cnt ? c->cmd_left : block_cnt;
+
+  if (r->write)
+    output_sectors (c, c->xfer_buffer, cnt);
+  else
+    input_sectors (c, c->xfer_buffer, cnt);
+  c->xfer_buffer += cnt * BLOCK_SECTOR_SIZE;
+  c->cmd_left -= cnt;
+}
+
+/* Advances channel C's active request in response to an
+   interrupt that reported STATUS.  A read interrupts when each
+   block of data is ready; a write, after each block is written.
+   When the request is done, completes it and starts the next
+   one in the queue, if any. */
+static void
+service_request (struct channel *c, uint8_t status) 
+{
+  struct block_request *r = c->active;
+  struct ata_disk *d = r->driver;
+
+  if (c->cmd_dma)
+    finish_dma (c);
+  if ((status & (STA_BSY | STA_ERR)) != 0
+      || (c->cmd_left > 0 && (status & STA_DRQ) == 0))
+    PANIC ("%s: disk %s failed, sector=%"PRDSNu, d->name,
+           r->write ? "write" : "read",
+           c->xfer_sector - c->cmd_left);
+
+  /* Move the next block of data, and wait for the next
+     interrupt if this command has more to go. */
+  if (c->cmd_left > 0) 
+    {
+      transfer_block (c);
+      if (c->cmd_left > 0 || r->write)
+        return;
+    }
+
+  /* Start the next command, if the request needs more. */
+  if (c->xfer_left > 0) 
+    {
+      start_command (c);
+      return;
+    }
+
+  /* The request is done. */
+  c->head = c->xfer_sector;
+  c->active = NULL;
+  if (!list_empty (&c->queue))
+    start_request (c);
+  block_complete (r);
+}
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO to the disk's sector selection registers and
+   CNT, which must be between 1 and MAX_COMMAND_SECTORS, to its
+   sector count register.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sectors (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_COMMAND_SECTORS);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == MAX_COMMAND_SECTORS ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -402,38 +771,42 @@ select_sector (struct ata_disk *d, block_sector_t sec_no)
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
-   completion interrupt. */
+   completion interrupt.  If no request is active, the interrupt
+   handler ups C's completion_wait, so interrupts must then be
+   enabled for the caller to wait on it. */
 static void
 issue_pio_command (struct channel *c, uint8_t command) 
 {
-  /* Interrupts must be enabled or our semaphore will never be
-     up'd by the completion handler. */
-  ASSERT (intr_get_level () == INTR_ON);
+  ASSERT (c->active != NULL || intr_get_level () == INTR_ON);
 
   c->expecting_interrupt = true;
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, size_t cnt) 
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register in
+   PIO mode.  SECTORS must contain CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, size_t cnt) 
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
 
-/* Wait up to 10 seconds for the controller to become idle, that
-   is, for the BSY and DRQ bits to clear in the status register.
+/* Wait up to 10 milliseconds for the controller to become idle,
+   that is, for the BSY and DRQ bits to clear in the status
+   register.  Busy-waits, so that it may be used with interrupts
+   off, as when starting a request.
 
    As a side effect, reading the status register clears any
    pending interrupt. */
@@ -446,7 +819,7 @@ wait_until_idle (const struct ata_disk *d)
     {
       if ((inb (reg_status (d->channel)) & (STA_BSY | STA_DRQ)) == 0)
         return;
-      timer_usleep (10);
+      timer_udelay (10);
     }
 
   printf ("%s: idle timeout\n", d->name);
@@ -479,7 +852,29 @@ wait_while_busy (const struct ata_disk *d)
   return false;
 }
 
-/* Program D's channel so that D is now the selected disk. */
+/* Wait up to 10 milliseconds for disk D to clear BSY and
+   then return the status of the DRQ bit.  Unlike
+   wait_while_busy(), busy-waits instead of sleeping, so that it
+   may be used with interrupts off. */
+static bool
+wait_for_drq (const struct ata_disk *d) 
+{
+  struct channel *c = d->channel;
+  int i;
+
+  for (i = 0; i < 1000; i++) 
+    {
+      uint8_t status = inb (reg_alt_status (c));
+      if (!(status & STA_BSY))
+        return (status & STA_DRQ) != 0;
+      timer_udelay (10);
+    }
+  return false;
+}
+
+/* Program D's channel so that D is now the selected disk.
+   Busy-waits for the selection to settle, so that it may be used
+   with interrupts off. */
 static void
 select_device (const struct ata_disk *d)
 {
@@ -489,7 +884,7 @@ select_device (const struct ata_disk *d)
     dev |= DEV_DEV;
   outb (reg_device (c), dev);
   inb (reg_alt_status (c));
-  timer_nsleep (400);
+  timer_ndelay (400);
 }
 
 /* Select disk D in its channel, as select_device(), but wait for
@@ -511,7 +906,9 @@ interrupt_handler (struct intr_frame *f)
   for (c = channels; c < channels + CHANNEL_CNT; c++)
     if (f->vec_no == c->irq)
       {
-        if (c->expecting_interrupt) 
+        if (c->active != NULL)
+          service_request (c, inb (reg_status (c)));
+        else if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
             sema_up (&c->completion_wait);      /* Wake up waiter. */
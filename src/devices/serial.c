@@ -1,7 +1,8 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <list.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +34,13 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* FIFOs are enabled. */
+
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear receive and transmit FIFOs. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,11 +59,31 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Size of the 16550A's transmit FIFO, in bytes. */
+#define FIFO_SIZE 16
+
+/* Number of bytes that may be written to THR each time it
+   empties: FIFO_SIZE if the UART has working FIFOs, otherwise 1. */
+static int xmit_burst;
+
+/* Size of the transmit queue, in bytes.  Must be a power of 2. */
+#define TXQ_SIZE 4096
+
+/* Data to be transmitted: a circular buffer shared with the
+   interrupt handler.  TXQ_HEAD counts bytes ever added and
+   TXQ_TAIL bytes ever removed, so that TXQ_HEAD - TXQ_TAIL is the
+   number of bytes in the queue.  Accessed only with interrupts
+   off. */
+static uint8_t txq[TXQ_SIZE];
+static size_t txq_head, txq_tail;
+
+/* Threads waiting for room in the transmit queue. */
+static struct list txq_waiters;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void xmit_poll (void);
+static void xmit_burst_out (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,10 +96,11 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR); /* Enable and clear FIFOs. */
+  xmit_burst = (inb (IIR_REG) & IIR_FIFO) == IIR_FIFO ? FIFO_SIZE : 1;
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  list_init (&txq_waiters);
   mode = POLL;
 } 
 
@@ -98,32 +127,64 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_write (&byte, 1);
+}
+
+/* Sends the N bytes in BUFFER to the serial port. */
+void
+serial_write (const void *buffer_, size_t n) 
+{
+  const uint8_t *buffer = buffer_;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit each byte. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (n-- > 0)
+        putc_poll (*buffer++);
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, copy as much as fits into the transmit queue
+         at a time and update the interrupt enable register. */
+      while (n > 0) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          size_t head = txq_head % TXQ_SIZE;
+          size_t room = TXQ_SIZE - (txq_head - txq_tail);
+          size_t chunk;
+
+          if (room == 0) 
+            {
+              if (old_level == INTR_OFF) 
+                {
+                  /* Interrupts are off and the transmit queue is
+                     full.  If we wanted to wait for the queue to
+                     empty, we'd have to reenable interrupts.
+                     That's impolite, so we'll send some bytes
+                     via polling instead. */
+                  xmit_poll ();
+                }
+              else 
+                {
+                  /* Wait for the interrupt handler to make room. */
+                  list_push_back (&txq_waiters, &thread_current ()->elem);
+                  thread_block ();
+                }
+              continue;
+            }
+
+          chunk = n < room ? n : room;
+          if (chunk > TXQ_SIZE - head)
+            chunk = TXQ_SIZE - head;
+          memcpy (txq + head, buffer, chunk);
+          txq_head += chunk;
+          buffer += chunk;
+          n -= chunk;
+          write_ier ();
         }
-
-      intq_putc (&txq, byte); 
-      write_ier ();
     }
   
   intr_set_level (old_level);
@@ -135,8 +196,8 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (txq_head != txq_tail)
+    xmit_poll ();
   intr_set_level (old_level);
 }
 
@@ -182,7 +243,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (txq_head != txq_tail)
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -205,6 +266,38 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Polls the serial port until it's ready, and then transmits
+   as many bytes from the transmit queue as it can accept. */
+static void
+xmit_poll (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while ((inb (LSR_REG) & LSR_THRE) == 0)
+    continue;
+  xmit_burst_out ();
+}
+
+/* Moves up to XMIT_BURST bytes from the transmit queue into the
+   UART, whose transmit holding register must be empty, and
+   wakes up any threads waiting for room once the queue is at
+   most half full. */
+static void
+xmit_burst_out (void) 
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (i = 0; i < xmit_burst && txq_head != txq_tail; i++)
+    outb (THR_REG, txq[txq_tail++ % TXQ_SIZE]);
+
+  if (txq_head - txq_tail <= TXQ_SIZE / 2)
+    while (!list_empty (&txq_waiters))
+      thread_unblock (list_entry (list_pop_front (&txq_waiters),
+                                  struct thread, elem));
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +311,10 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If we have bytes to transmit, and the hardware is ready to
+     accept them, fill its transmit FIFO. */
+  if (txq_head != txq_tail && (inb (LSR_REG) & LSR_THRE) != 0)
+    xmit_burst_out ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -5,14 +5,22 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -120,7 +128,11 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  malloc_print_stats ();
+  kmem_cache_print_stats ();
 #ifdef FILESYS
+  cache_print_stats ();
+  dcache_print_stats ();
   block_print_stats ();
 #endif
   console_print_stats ();
@@ -128,4 +140,8 @@ print_stats (void)
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  frame_print_stats ();
+  swap_print_stats ();
+#endif
 }
@@ -0,0 +1,537 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#ifdef USERPROG
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#endif
+
+/* Number of sectors in the cache. */
+#define CACHE_SIZE 64
+
+/* Interval at which dirty sectors are written behind. */
+#define WRITE_BEHIND_TICKS TIMER_FREQ
+
+/* Maximum number of queued read-ahead requests.  Requests made
+   while the queue is full are dropped. */
+#define READAHEAD_MAX 16
+
+/* Shortest run of uncached sectors that cache_read_multiple()
+   reads around the cache.  Shorter runs, such as the pages of an
+   executable, are likely to be read again and so are cached. */
+#define DIRECT_MIN (CACHE_SIZE / 4)
+
+/* Most disk requests that read_direct() has outstanding at
+   once. */
+#define DIRECT_BATCH 8
+
+/* Marks a cache entry that holds no sector. */
+#define NO_SECTOR ((block_sector_t) -1)
+
+/* A cached sector.
+
+   An entry with a nonzero pin count cannot be evicted, so its
+   SECTOR stays put.  Only threads that have pinned an entry may
+   acquire its lock, which in turn protects the data.  Thus an
+   unpinned entry's lock is always free. */
+struct cache_entry 
+  {
+    /* Protected by cache_lock. */
+    block_sector_t sector;              /* Sector held, or NO_SECTOR. */
+    int pin_cnt;                        /* Number of users. */
+    bool accessed;                      /* Used since last clock sweep? */
+
+    /* Protected by LOCK. */
+    struct lock lock;                   /* Held while using DATA. */
+    bool valid;                         /* DATA read from disk? */
+    bool dirty;                         /* DATA newer than disk? */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Sector contents. */
+  };
+
+/* How cache_get() is going to use an entry. */
+enum cache_use 
+  {
+    CACHE_READ,                         /* Read some or all of it. */
+    CACHE_OVERWRITE,                    /* Replace all of it. */
+    CACHE_PREFETCH                      /* Read ahead of demand. */
+  };
+
+static struct cache_entry cache[CACHE_SIZE];
+static struct lock cache_lock;
+static size_t clock_hand;
+
+/* Incremented, under cache_lock, before each write of a dirty
+   entry back to disk.  Lets cache_read_multiple() tell whether
+   the disk may have changed under a read that bypassed the
+   cache. */
+static unsigned writeback_gen;
+
+/* Statistics. */
+static long long hit_cnt;               /* Requests satisfied in cache. */
+static long long miss_cnt;              /* Requests that evicted a sector. */
+static long long prefetch_cnt;          /* Sectors read ahead. */
+static long long direct_cnt;            /* Sectors read around the cache. */
+
+/* Queue of sectors for the read-ahead thread to fetch. */
+static block_sector_t readahead_queue[READAHEAD_MAX];
+static size_t readahead_head, readahead_cnt;
+static struct lock readahead_lock;
+static struct condition readahead_cond;
+
+static thread_func write_behind_daemon NO_RETURN;
+static thread_func readahead_daemon NO_RETURN;
+
+/* Initializes the buffer cache and starts its write-behind and
+   read-ahead threads. */
+void
+cache_init (void) 
+{
+  size_t i;
+
+  lock_init (&cache_lock);
+  for (i = 0; i < CACHE_SIZE; i++) 
+    {
+      struct cache_entry *e = &cache[i];
+      e->sector = NO_SECTOR;
+      e->pin_cnt = 0;
+      e->accessed = false;
+      lock_init (&e->lock);
+      e->valid = false;
+      e->dirty = false;
+    }
+
+  lock_init (&readahead_lock);
+  cond_init (&readahead_cond);
+
+  thread_create ("write-behind", PRI_DEFAULT, write_behind_daemon, NULL);
+  thread_create ("read-ahead", PRI_DEFAULT, readahead_daemon, NULL);
+}
+
+/* Returns the entry holding SECTOR, or a null pointer if SECTOR
+   is not cached.  Must be called with cache_lock held. */
+static struct cache_entry *
+lookup (block_sector_t sector) 
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].sector == sector)
+      return &cache[i];
+  return NULL;
+}
+
+/* Chooses an unpinned entry to replace, preferring empty entries
+   and otherwise using the clock algorithm.  Returns a null
+   pointer if every entry is pinned.  Must be called with
+   cache_lock held. */
+static struct cache_entry *
+choose_victim (void) 
+{
+  size_t i;
+
+  for (i = 0; i < 2 * CACHE_SIZE; i++) 
+    {
+      struct cache_entry *e = &cache[clock_hand];
+      clock_hand = (clock_hand + 1) % CACHE_SIZE;
+      if (e->pin_cnt > 0)
+        continue;
+      if (e->sector == NO_SECTOR || !e->accessed)
+        return e;
+      e->accessed = false;
+    }
+  return NULL;
+}
+
+/* Returns a pinned entry for SECTOR with its lock held, evicting
+   another sector if SECTOR is not already cached.  Unless USE
+   is CACHE_OVERWRITE, the entry's data is valid on return.  The
+   caller must release the entry with cache_put(). */
+static struct cache_entry *
+cache_get (block_sector_t sector, enum cache_use use) 
+{
+  struct cache_entry *e;
+
+  ASSERT (sector != NO_SECTOR);
+
+  lock_acquire (&cache_lock);
+  for (;;) 
+    {
+      e = lookup (sector);
+      if (e != NULL) 
+        {
+          if (use != CACHE_PREFETCH)
+            hit_cnt++;
+          e->pin_cnt++;
+          e->accessed = true;
+          lock_release (&cache_lock);
+          lock_acquire (&e->lock);
+          break;
+        }
+
+      e = choose_victim ();
+      if (e != NULL) 
+        {
+          /* E is unpinned, so its lock is free. */
+          lock_acquire (&e->lock);
+          if (e->valid && e->dirty) 
+            {
+              /* Write back E's old contents without holding
+                 cache_lock, so that other threads can use the
+                 cache meanwhile.  Pinning E keeps the old sector
+                 in it, so that a thread that wants that sector
+                 waits for E's lock instead of reading a stale
+                 copy from disk.  Then look again, since SECTOR
+                 may have been brought in meanwhile. */
+              e->pin_cnt++;
+              writeback_gen++;
+              lock_release (&cache_lock);
+              block_write (fs_device, e->sector, e->data);
+              e->dirty = false;
+              lock_release (&e->lock);
+              lock_acquire (&cache_lock);
+              e->pin_cnt--;
+              continue;
+            }
+          if (use != CACHE_PREFETCH)
+            miss_cnt++;
+          else
+            prefetch_cnt++;
+          e->sector = sector;
+          e->pin_cnt = 1;
+          e->accessed = true;
+          e->valid = false;
+          e->dirty = false;
+          lock_release (&cache_lock);
+          break;
+        }
+
+      /* Every entry is in use.  Let other threads finish with
+         theirs, then look again, since SECTOR may have been
+         brought in meanwhile. */
+      lock_release (&cache_lock);
+      thread_yield ();
+      lock_acquire (&cache_lock);
+    }
+
+  if (!e->valid && use != CACHE_OVERWRITE) 
+    {
+      block_read (fs_device, sector, e->data);
+      e->valid = true;
+    }
+  return e;
+}
+
+/* Releases entry E obtained from cache_get(), marking it dirty
+   if DIRTY is true. */
+static void
+cache_put (struct cache_entry *e, bool dirty) 
+{
+  if (dirty)
+    e->dirty = true;
+  lock_release (&e->lock);
+
+  lock_acquire (&cache_lock);
+  ASSERT (e->pin_cnt > 0);
+  e->pin_cnt--;
+  lock_release (&cache_lock);
+}
+
+/* Copies SIZE bytes starting at offset OFS within SECTOR into
+   BUFFER. */
+void
+cache_read (block_sector_t sector, void *buffer, off_t ofs, off_t size) 
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, CACHE_READ);
+  memcpy (buffer, e->data + ofs, size);
+  cache_put (e, false);
+}
+
+#ifdef USERPROG
+/* Waits for the CNT requests in REQS to complete. */
+static void
+wait_requests (struct block_request reqs[], size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    block_wait (&reqs[i]);
+}
+#endif
+
+/* Reads the CNT sectors starting at SECTOR from disk straight
+   into BUFFER, bypassing the cache.
+
+   BUFFER may be in user memory, as when a process reads a file,
+   but a disk transfer needs kernel memory.  Such a buffer is
+   read a page at a time through the kernel's mapping of each
+   page, with the requests for several pages outstanding at
+   once.  The caller must ensure that the pages stay put.  A
+   sector that straddles two pages of the buffer is read through
+   the cache.  The CPU does not mark a page dirty or accessed when
+   the disk fills it through the kernel's mapping, so we do, lest
+   the page be evicted as clean and the data lost. */
+static void
+read_direct (block_sector_t sector, size_t cnt, uint8_t *buffer) 
+{
+#ifdef USERPROG
+  struct block_request reqs[DIRECT_BATCH];
+  size_t req_cnt = 0;
+
+  if (is_kernel_vaddr (buffer))
+    {
+      block_read_multiple (fs_device, sector, cnt, buffer);
+      return;
+    }
+
+  while (cnt > 0) 
+    {
+      size_t run = (PGSIZE - pg_ofs (buffer)) / BLOCK_SECTOR_SIZE;
+
+      if (run > cnt)
+        run = cnt;
+      if (run > 0) 
+        {
+          uint32_t *pd = thread_current ()->pagedir;
+          void *kbuffer = pagedir_get_page (pd, buffer);
+          ASSERT (kbuffer != NULL);
+          pagedir_set_dirty (pd, buffer, true);
+          pagedir_set_accessed (pd, buffer, true);
+          if (req_cnt == DIRECT_BATCH) 
+            {
+              wait_requests (reqs, req_cnt);
+              req_cnt = 0;
+            }
+          block_request_init (&reqs[req_cnt], false, sector, run, kbuffer,
+                              NULL, NULL);
+          block_submit (fs_device, &reqs[req_cnt++]);
+        }
+      else 
+        {
+          cache_read (sector, buffer, 0, BLOCK_SECTOR_SIZE);
+          run = 1;
+        }
+
+      sector += run;
+      buffer += run * BLOCK_SECTOR_SIZE;
+      cnt -= run;
+    }
+  wait_requests (reqs, req_cnt);
+#else
+  block_read_multiple (fs_device, sector, cnt, buffer);
+#endif
+}
+
+/* Brings up to date BUFFER, into which read_direct() read the
+   CNT sectors starting at SECTOR.  GEN is the value that
+   writeback_gen had when none of those sectors was cached,
+   before the read began.
+
+   Any of the sectors that were brought into the cache while
+   read_direct() was reading them are copied again from the
+   cache, since the cached copy may be newer than what was on
+   disk, for example if another thread wrote the sector
+   meanwhile and it has not yet been written back.
+
+   A sector may also have been cached, modified, written back,
+   and evicted during the read, leaving the read with a stale
+   copy and no trace in the cache.  That can only happen if
+   writeback_gen changed, in which case every sector is read
+   again through the cache. */
+static void
+recheck_direct (block_sector_t sector, size_t cnt, uint8_t *buffer,
+                unsigned gen) 
+{
+  bool written_back;
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  written_back = writeback_gen != gen;
+  lock_release (&cache_lock);
+
+  for (i = 0; i < cnt; i++) 
+    {
+      bool cached = written_back;
+
+      if (!cached) 
+        {
+          lock_acquire (&cache_lock);
+          cached = lookup (sector + i) != NULL;
+          lock_release (&cache_lock);
+        }
+
+      if (cached)
+        cache_read (sector + i, buffer + i * BLOCK_SECTOR_SIZE,
+                    0, BLOCK_SECTOR_SIZE);
+    }
+}
+
+/* Copies the CNT whole sectors starting at SECTOR into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.
+
+   Sectors that are in the cache are copied from it, so that any
+   changes not yet written back are seen.  Each run of at least
+   DIRECT_MIN of the others is read from disk straight into
+   BUFFER with one multi-sector request, without caching them: a
+   large sequential read would otherwise push out the whole cache
+   for data that will probably not be read again soon.
+   recheck_direct() then catches any of those sectors that
+   changed while the read was in progress.  Shorter runs go
+   through the cache one sector at a time. */
+void
+cache_read_multiple (block_sector_t sector, size_t cnt, void *buffer_) 
+{
+  uint8_t *buffer = buffer_;
+
+  while (cnt > 0) 
+    {
+      size_t run;
+
+      /* Count the uncached sectors at the start of the range. */
+      lock_acquire (&cache_lock);
+      for (run = 0; run < cnt && lookup (sector + run) == NULL; run++)
+        continue;
+
+      if (run >= DIRECT_MIN) 
+        {
+          unsigned gen = writeback_gen;
+
+          direct_cnt += run;
+          lock_release (&cache_lock);
+          read_direct (sector, run, buffer);
+          recheck_direct (sector, run, buffer, gen);
+        }
+      else 
+        {
+          lock_release (&cache_lock);
+          cache_read (sector, buffer, 0, BLOCK_SECTOR_SIZE);
+          run = 1;
+        }
+
+      sector += run;
+      buffer += run * BLOCK_SECTOR_SIZE;
+      cnt -= run;
+    }
+}
+
+/* Copies SIZE bytes from BUFFER into SECTOR starting at offset
+   OFS.  The write reaches disk later, when the sector is evicted
+   or flushed. */
+void
+cache_write (block_sector_t sector, const void *buffer,
+             off_t ofs, off_t size) 
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, (ofs == 0 && size == BLOCK_SECTOR_SIZE
+                          ? CACHE_OVERWRITE : CACHE_READ));
+  memcpy (e->data + ofs, buffer, size);
+  e->valid = true;
+  cache_put (e, true);
+}
+
+/* Writes every dirty sector in the cache to disk. */
+void
+cache_flush (void) 
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++) 
+    {
+      struct cache_entry *e = &cache[i];
+
+      lock_acquire (&cache_lock);
+      if (e->sector == NO_SECTOR) 
+        {
+          lock_release (&cache_lock);
+          continue;
+        }
+      e->pin_cnt++;
+      lock_release (&cache_lock);
+
+      lock_acquire (&e->lock);
+      if (e->valid && e->dirty) 
+        {
+          lock_acquire (&cache_lock);
+          writeback_gen++;
+          lock_release (&cache_lock);
+          block_write (fs_device, e->sector, e->data);
+          e->dirty = false;
+        }
+      cache_put (e, false);
+    }
+}
+
+/* Asks the read-ahead thread to bring SECTOR into the cache, if
+   there is room in its queue. */
+void
+cache_readahead (block_sector_t sector) 
+{
+  lock_acquire (&readahead_lock);
+  if (readahead_cnt < READAHEAD_MAX) 
+    {
+      size_t tail = (readahead_head + readahead_cnt) % READAHEAD_MAX;
+      readahead_queue[tail] = sector;
+      readahead_cnt++;
+      cond_signal (&readahead_cond, &readahead_lock);
+    }
+  lock_release (&readahead_lock);
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void) 
+{
+  long long request_cnt = hit_cnt + miss_cnt;
+
+  printf ("Buffer cache: %lld hits, %lld misses (%lld%% hit rate), "
+          "%lld read-aheads, %lld direct reads\n", hit_cnt, miss_cnt,
+          request_cnt > 0 ? hit_cnt * 100 / request_cnt : 0,
+          prefetch_cnt, direct_cnt);
+}
+
+/* Periodically writes dirty sectors back to disk, so that a
+   crash loses at most WRITE_BEHIND_TICKS worth of writes.  The
+   free map batches its own changes, so they are brought into the
+   cache first. */
+static void
+write_behind_daemon (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      timer_sleep (WRITE_BEHIND_TICKS);
+      free_map_flush ();
+      cache_flush ();
+    }
+}
+
+/* Fetches sectors queued by cache_readahead() into the cache. */
+static void
+readahead_daemon (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      block_sector_t sector;
+
+      lock_acquire (&readahead_lock);
+      while (readahead_cnt == 0)
+        cond_wait (&readahead_cond, &readahead_lock);
+      sector = readahead_queue[readahead_head];
+      readahead_head = (readahead_head + 1) % READAHEAD_MAX;
+      readahead_cnt--;
+      lock_release (&readahead_lock);
+
+      cache_put (cache_get (sector, CACHE_PREFETCH), false);
+    }
+}
@@ -0,0 +1,173 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Maximum number of cached directory entries.  When the cache
+   is full, the least recently used entry is discarded. */
+#define DCACHE_MAX 256
+
+/* A cached directory entry: the file named NAME in the directory
+   whose inode is in sector DIR has its inode in SECTOR. */
+struct dentry 
+  {
+    struct hash_elem hash_elem;         /* Element in dentries. */
+    struct list_elem lru_elem;          /* Element in lru_list. */
+    block_sector_t dir;                 /* Directory's inode sector. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+    block_sector_t sector;              /* Named file's inode sector. */
+  };
+
+static struct hash dentries;            /* Cached entries. */
+static struct list lru_list;            /* Most recently used first. */
+static size_t dentry_cnt;               /* Number of cached entries. */
+static struct lock dcache_lock;         /* Protects all of the above. */
+
+/* Statistics. */
+static long long hit_cnt, miss_cnt;
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+
+/* Initializes the dentry cache. */
+void
+dcache_init (void) 
+{
+  hash_init (&dentries, dentry_hash, dentry_less, NULL);
+  list_init (&lru_list);
+  lock_init (&dcache_lock);
+}
+
+/* Returns the cached entry for NAME in DIR, or a null pointer if
+   there is none.  Must be called with dcache_lock held. */
+static struct dentry *
+find (block_sector_t dir, const char *name) 
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentries, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Looks up NAME in the directory whose inode is in sector DIR.
+   If it is cached, stores the sector of its inode into *SECTORP
+   and returns true.  Otherwise, returns false. */
+bool
+dcache_lookup (block_sector_t dir, const char *name,
+               block_sector_t *sectorp) 
+{
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL) 
+    {
+      hit_cnt++;
+      *sectorp = d->sector;
+      list_remove (&d->lru_elem);
+      list_push_front (&lru_list, &d->lru_elem);
+    }
+  else
+    miss_cnt++;
+  lock_release (&dcache_lock);
+
+  return d != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in sector
+   DIR has its inode in SECTOR.  Caching is best effort, so this
+   silently does nothing if memory is short. */
+void
+dcache_insert (block_sector_t dir, const char *name, block_sector_t sector) 
+{
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL) 
+    {
+      d->sector = sector;
+      list_remove (&d->lru_elem);
+    }
+  else 
+    {
+      if (dentry_cnt >= DCACHE_MAX) 
+        {
+          d = list_entry (list_pop_back (&lru_list), struct dentry, lru_elem);
+          hash_delete (&dentries, &d->hash_elem);
+        }
+      else 
+        {
+          d = malloc (sizeof *d);
+          if (d == NULL) 
+            {
+              lock_release (&dcache_lock);
+              return;
+            }
+          dentry_cnt++;
+        }
+      d->dir = dir;
+      strlcpy (d->name, name, sizeof d->name);
+      d->sector = sector;
+      hash_insert (&dentries, &d->hash_elem);
+    }
+  list_push_front (&lru_list, &d->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets any cached entry for NAME in the directory whose inode
+   is in sector DIR. */
+void
+dcache_remove (block_sector_t dir, const char *name) 
+{
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL) 
+    {
+      hash_delete (&dentries, &d->hash_elem);
+      list_remove (&d->lru_elem);
+      dentry_cnt--;
+      free (d);
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Prints dentry cache statistics. */
+void
+dcache_print_stats (void) 
+{
+  printf ("Dentry cache: %lld hits, %lld misses\n", hit_cnt, miss_cnt);
+}
+
+/* Returns a hash value for dentry E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->dir != b->dir)
+    return a->dir < b->dir;
+  return strcmp (a->name, b->name) < 0;
+}
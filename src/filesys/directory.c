@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -22,11 +23,25 @@ struct dir_entry
   };
 
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, whose parent directory is in PARENT_SECTOR.  The
+   new directory starts out with entries "." and "..", for
+   itself and its parent; it grows as more entries are added.
+   Returns true if successful, false on failure. */
 bool
-dir_create (block_sector_t sector, size_t entry_cnt)
+dir_create (block_sector_t sector, block_sector_t parent_sector,
+            size_t entry_cnt)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  struct dir *dir;
+  bool success;
+
+  if (!inode_create (sector, entry_cnt * sizeof (struct dir_entry), true))
+    return false;
+  dir = dir_open (inode_open (sector));
+  success = (dir != NULL
+             && dir_add (dir, ".", sector)
+             && dir_add (dir, "..", parent_sector));
+  dir_close (dir);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -114,18 +129,27 @@ lookup (const struct dir *dir, const char *name,
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
-   a null pointer.  The caller must close *INODE. */
+   a null pointer.  The caller must close *INODE.
+   Consults the dentry cache before reading DIR itself. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
+  block_sector_t dir_sector, sector;
   struct dir_entry e;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+  dir_sector = inode_get_inumber (dir->inode);
+
+  if (dcache_lookup (dir_sector, name, &sector))
+    *inode = inode_open (sector);
+  else if (lookup (dir, name, &e, NULL)) 
+    {
+      dcache_insert (dir_sector, name, e.inode_sector);
+      *inode = inode_open (e.inode_sector);
+    }
   else
     *inode = NULL;
 
@@ -173,17 +197,38 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  if (success)
+    dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
 
  done:
   return success;
 }
 
+/* Returns true if the directory in INODE contains no entries
+   other than "." and "..", false otherwise. */
+static bool
+is_empty (struct inode *inode) 
+{
+  struct dir_entry e;
+  off_t ofs;
+
+  for (ofs = 0; inode_read_at (inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e) 
+    if (e.in_use && strcmp (e.name, ".") && strcmp (e.name, ".."))
+      return false;
+  return true;
+}
+
 /* Removes any entry for NAME in DIR.
    Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   which occurs if there is no file with the given NAME, if NAME
+   is "." or "..", or if NAME is a directory that is not empty
+   or that is open elsewhere (for example, as some process's
+   working directory). */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
+  block_sector_t dir_sector;
   struct dir_entry e;
   struct inode *inode = NULL;
   bool success = false;
@@ -192,8 +237,11 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  dir_sector = inode_get_inumber (dir->inode);
+
   /* Find directory entry. */
-  if (!lookup (dir, name, &e, &ofs))
+  if (!strcmp (name, ".") || !strcmp (name, "..")
+      || !lookup (dir, name, &e, &ofs))
     goto done;
 
   /* Open inode. */
@@ -201,10 +249,21 @@ dir_remove (struct dir *dir, const char *name)
   if (inode == NULL)
     goto done;
 
+  /* A directory may be removed only if nothing else uses it. */
+  if (inode_is_dir (inode)
+      && (inode_open_cnt (inode) > 1 || !is_empty (inode)))
+    goto done;
+
   /* Erase directory entry. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
+  dcache_remove (dir_sector, name);
+  if (inode_is_dir (inode)) 
+    {
+      dcache_remove (e.inode_sector, ".");
+      dcache_remove (e.inode_sector, "..");
+    }
 
   /* Remove inode. */
   inode_remove (inode);
@@ -217,7 +276,7 @@ dir_remove (struct dir *dir, const char *name)
 
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
-   contains no more entries. */
+   contains no more entries.  Skips the "." and ".." entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
@@ -226,7 +285,7 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
       dir->pos += sizeof e;
-      if (e.in_use)
+      if (e.in_use && strcmp (e.name, ".") && strcmp (e.name, ".."))
         {
           strlcpy (name, e.name, NAME_MAX + 1);
           return true;
@@ -234,3 +293,21 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
     }
   return false;
 }
+
+/* Sets the position in DIR at which dir_readdir() resumes to
+   NEW_POS, which should have been obtained from dir_tell(). */
+void
+dir_seek (struct dir *dir, off_t new_pos) 
+{
+  ASSERT (dir != NULL);
+  ASSERT (new_pos >= 0);
+  dir->pos = new_pos;
+}
+
+/* Returns the position in DIR at which dir_readdir() resumes. */
+off_t
+dir_tell (const struct dir *dir) 
+{
+  ASSERT (dir != NULL);
+  return dir->pos;
+}
@@ -2,15 +2,22 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "threads/thread.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
 static void do_format (void);
+static struct dir *resolve_path (const char *path,
+                                 char name[NAME_MAX + 1]);
+static void discard_inode (block_sector_t inode_sector, bool created);
+static block_sector_t dir_sector (struct dir *);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -21,7 +28,10 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
+  dcache_init ();
   inode_init ();
+  file_init ();
   free_map_init ();
 
   if (format) 
@@ -36,29 +46,61 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
+   NAME may be an absolute or relative path.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
    or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
+  char base[NAME_MAX + 1];
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
+  bool created = false;
+  struct dir *dir = resolve_path (name, base);
   bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+                  && free_map_allocate (1, dir_sector (dir), &inode_sector)
+                  && (created = inode_create (inode_sector, initial_size,
+                                              false))
+                  && dir_add (dir, base, inode_sector));
   if (!success && inode_sector != 0) 
-    free_map_release (inode_sector, 1);
+    discard_inode (inode_sector, created);
   dir_close (dir);
 
   return success;
 }
 
-/* Opens the file with the given NAME.
+/* Creates a directory named NAME, which may be an absolute or
+   relative path.  Returns true if successful, false otherwise.
+   Fails if a file named NAME already exists, if its parent
+   directory does not exist, or if internal memory allocation
+   fails. */
+bool
+filesys_mkdir (const char *name) 
+{
+  char base[NAME_MAX + 1];
+  block_sector_t inode_sector;
+  struct dir *dir = resolve_path (name, base);
+  bool success = false;
+
+  if (dir != NULL && free_map_allocate (1, dir_sector (dir), &inode_sector)) 
+    {
+      bool created = dir_create (inode_sector, dir_sector (dir), 0);
+
+      success = created && dir_add (dir, base, inode_sector);
+      if (!success)
+        discard_inode (inode_sector, created);
+    }
+  dir_close (dir);
+
+  return success;
+}
+
+/* Opens the file or directory with the given NAME, which may be
+   an absolute or relative path.
    Returns the new file if successful or a null pointer
    otherwise.
    Fails if no file named NAME exists,
@@ -66,29 +108,165 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
+  char base[NAME_MAX + 1];
+  struct dir *dir = resolve_path (name, base);
   struct inode *inode = NULL;
 
   if (dir != NULL)
-    dir_lookup (dir, name, &inode);
+    dir_lookup (dir, base, &inode);
   dir_close (dir);
 
   return file_open (inode);
 }
 
-/* Deletes the file named NAME.
+/* Deletes the file or empty directory named NAME, which may be
+   an absolute or relative path.
    Returns true if successful, false on failure.
-   Fails if no file named NAME exists,
-   or if an internal memory allocation fails. */
+   Fails if no file named NAME exists, if NAME is a directory
+   that is not empty or is in use, or if an internal memory
+   allocation fails. */
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  char base[NAME_MAX + 1];
+  struct dir *dir = resolve_path (name, base);
+  bool success = dir != NULL && dir_remove (dir, base);
   dir_close (dir); 
 
   return success;
 }
+
+/* Changes the running thread's working directory to NAME, which
+   may be an absolute or relative path.
+   Returns true if successful, false on failure. */
+bool
+filesys_chdir (const char *name) 
+{
+  struct thread *t = thread_current ();
+  char base[NAME_MAX + 1];
+  struct dir *dir = resolve_path (name, base);
+  struct inode *inode = NULL;
+
+  if (dir != NULL)
+    dir_lookup (dir, base, &inode);
+  dir_close (dir);
+
+  if (inode == NULL || !inode_is_dir (inode)) 
+    {
+      inode_close (inode);
+      return false;
+    }
+  dir = dir_open (inode);
+  if (dir == NULL)
+    return false;
+
+  dir_close (t->cwd);
+  t->cwd = dir;
+  return true;
+}
+
+/* Returns the sector of DIR's inode, near which new files in
+   DIR are placed. */
+static block_sector_t
+dir_sector (struct dir *dir) 
+{
+  return inode_get_inumber (dir_get_inode (dir));
+}
+
+/* Releases INODE_SECTOR, which was allocated for a new file or
+   directory that could not be added to its parent.  If CREATED
+   is true, an inode was written there, so the file's data is
+   released too. */
+static void
+discard_inode (block_sector_t inode_sector, bool created) 
+{
+  if (created) 
+    {
+      struct inode *inode = inode_open (inode_sector);
+      if (inode != NULL) 
+        {
+          inode_remove (inode);
+          inode_close (inode);
+          return;
+        }
+    }
+  free_map_release (inode_sector, 1);
+}
+
+/* Resolves every component of PATH except the last, starting
+   from the root directory if PATH begins with "/" and from the
+   running thread's working directory otherwise.  On success,
+   copies the last component into NAME and returns the directory
+   that should contain it, which the caller must close.  A PATH
+   that names the starting directory itself, such as "/", yields
+   that directory and the name ".".  Returns a null pointer if
+   PATH is empty, if a component is too long, or if a component
+   other than the last does not name a directory.
+
+   Each step looks up one component with dir_lookup(), so walks
+   over recently used paths are served by the dentry cache. */
+static struct dir *
+resolve_path (const char *path, char name[NAME_MAX + 1]) 
+{
+  struct thread *t = thread_current ();
+  struct dir *dir;
+  bool have_name = false;
+
+  if (*path == '\0')
+    return NULL;
+  if (*path == '/' || t->cwd == NULL)
+    dir = dir_open_root ();
+  else
+    dir = dir_reopen (t->cwd);
+  if (dir == NULL)
+    return NULL;
+
+  strlcpy (name, ".", NAME_MAX + 1);
+  for (;;) 
+    {
+      const char *start;
+      size_t len;
+
+      /* Find the next component. */
+      while (*path == '/')
+        path++;
+      if (*path == '\0')
+        break;
+      start = path;
+      while (*path != '/' && *path != '\0')
+        path++;
+      len = path - start;
+      if (len > NAME_MAX)
+        goto error;
+
+      /* Descend into the previous component, which must be a
+         directory, now that we know it is not the last. */
+      if (have_name) 
+        {
+          struct inode *inode;
+
+          dir_lookup (dir, name, &inode);
+          dir_close (dir);
+          if (inode == NULL || !inode_is_dir (inode)) 
+            {
+              inode_close (inode);
+              return NULL;
+            }
+          dir = dir_open (inode);
+          if (dir == NULL)
+            return NULL;
+        }
+
+      memcpy (name, start, len);
+      name[len] = '\0';
+      have_name = true;
+    }
+  return dir;
+
+ error:
+  dir_close (dir);
+  return NULL;
+}
 
 /* Formats the file system. */
 static void
@@ -96,7 +274,7 @@ do_format (void)
 {
   printf ("Formatting file system...");
   free_map_create ();
-  if (!dir_create (ROOT_DIR_SECTOR, 16))
+  if (!dir_create (ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
   free_map_close ();
   printf ("done.\n");
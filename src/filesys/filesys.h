@@ -9,12 +9,14 @@
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
 
 /* Block device that contains the file system. */
-struct block *fs_device;
+extern struct block *fs_device;
 
 void filesys_init (bool format);
 void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size);
+bool filesys_mkdir (const char *name);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
+bool filesys_chdir (const char *name);
 
 #endif /* filesys/filesys.h */
@@ -1,40 +1,87 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
 
+/* Sectors of the free map file whose contents have changed in
+   FREE_MAP since they were last written, one bit per sector.
+   Writing just these at sync points, instead of the whole file
+   after every change, keeps allocation cheap. */
+static struct bitmap *dirty_map;
+
+/* Protects the variables above.  Most free map operations are
+   already serialized by their callers, but free_map_flush() is
+   also called from the cache's write-behind thread. */
+static struct lock free_map_lock;
+
+/* Number of bits of the free map in one sector of its file. */
+#define BITS_PER_SECTOR (BLOCK_SECTOR_SIZE * 8)
+
+/* The disk is divided into groups of GROUP_SECTORS sectors, and
+   the number of free sectors in each group is kept in
+   GROUP_FREE, so that allocation can pass over full groups
+   without looking at their bits.  Protected by free_map_lock. */
+#define GROUP_SECTORS 256
+static size_t *group_free;
+static size_t group_cnt;
+
+static void mark_dirty (block_sector_t, size_t cnt);
+static void count_group_free (void);
+static void adjust_group_free (block_sector_t, size_t cnt, bool allocated);
+static block_sector_t scan_near (size_t cnt, block_sector_t near);
+
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
+  lock_init (&free_map_lock);
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
+  dirty_map = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                           BLOCK_SECTOR_SIZE));
+  if (dirty_map == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  group_cnt = DIV_ROUND_UP (bitmap_size (free_map), GROUP_SECTORS);
+  group_free = malloc (sizeof *group_free * group_cnt);
+  if (group_free == NULL)
+    PANIC ("free map group allocation failed");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  count_group_free ();
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
+   the first into *SECTORP.  The sectors are placed as soon after
+   sector NEAR as they fit, wrapping around to the start of the
+   disk if necessary, so that callers can keep related data
+   together by passing a sector that the new ones relate to.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available.  The change reaches the free map file
+   at the next free_map_flush(). */
 bool
-free_map_allocate (size_t cnt, block_sector_t *sectorp)
+free_map_allocate (size_t cnt, block_sector_t near, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  block_sector_t sector;
+
+  lock_acquire (&free_map_lock);
+  sector = scan_near (cnt, near < bitmap_size (free_map) ? near : 0);
+  if (sector != BITMAP_ERROR) 
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      bitmap_set_multiple (free_map, sector, cnt, true);
+      adjust_group_free (sector, cnt, true);
+      mark_dirty (sector, cnt);
     }
+  lock_release (&free_map_lock);
+
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
@@ -44,9 +91,148 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  adjust_group_free (sector, cnt, false);
+  mark_dirty (sector, cnt);
+  lock_release (&free_map_lock);
+}
+
+/* Returns the first sector of a run of CNT free sectors within
+   sectors START...END-1, or BITMAP_ERROR if there is no such
+   run. */
+static block_sector_t
+scan_range (size_t cnt, block_sector_t start, block_sector_t end) 
+{
+  block_sector_t sector;
+
+  for (sector = start; sector + cnt <= end; sector++)
+    if (bitmap_none (free_map, sector, cnt))
+      return sector;
+  return BITMAP_ERROR;
+}
+
+/* Returns the first sector of a run of CNT free sectors, the
+   first at or after NEAR that fits, wrapping around to the
+   start of the disk.  Looks only within groups that have enough
+   free sectors, so a full disk costs a pass over GROUP_FREE
+   instead of over the whole free map.  A run is not found if it
+   would span groups, unless CNT is too large for any group to
+   hold, in which case the whole map is searched.  Returns
+   BITMAP_ERROR if there is no such run.  Must be called with
+   free_map_lock held. */
+static block_sector_t
+scan_near (size_t cnt, block_sector_t near) 
+{
+  size_t sector_cnt = bitmap_size (free_map);
+  size_t first = near / GROUP_SECTORS;
+  size_t i;
+
+  if (cnt > GROUP_SECTORS) 
+    {
+      block_sector_t sector = bitmap_scan (free_map, near, cnt, false);
+      return (sector != BITMAP_ERROR
+              ? sector : bitmap_scan (free_map, 0, cnt, false));
+    }
+
+  /* NEAR's group is searched twice: first from NEAR upward, and
+     last, after all the other groups, for runs that start below
+     NEAR. */
+  for (i = 0; i <= group_cnt; i++) 
+    {
+      size_t group = (first + i) % group_cnt;
+      block_sector_t start = group * GROUP_SECTORS;
+      block_sector_t end = start + GROUP_SECTORS;
+      block_sector_t sector;
+
+      if (group_free[group] < cnt)
+        continue;
+      if (end > sector_cnt)
+        end = sector_cnt;
+      if (i == 0)
+        start = near;
+      else if (i == group_cnt && near + cnt - 1 < end)
+        end = near + cnt - 1;
+      sector = scan_range (cnt, start, end);
+      if (sector != BITMAP_ERROR)
+        return sector;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Recomputes GROUP_FREE from the free map. */
+static void
+count_group_free (void) 
+{
+  size_t sector_cnt = bitmap_size (free_map);
+  size_t group;
+
+  for (group = 0; group < group_cnt; group++) 
+    {
+      size_t start = group * GROUP_SECTORS;
+      size_t cnt = (sector_cnt - start < GROUP_SECTORS
+                    ? sector_cnt - start : GROUP_SECTORS);
+      group_free[group] = bitmap_count (free_map, start, cnt, false);
+    }
+}
+
+/* Updates GROUP_FREE for the CNT sectors starting at SECTOR
+   having been ALLOCATED, or freed if ALLOCATED is false. */
+static void
+adjust_group_free (block_sector_t sector, size_t cnt, bool allocated) 
+{
+  while (cnt > 0) 
+    {
+      size_t group = sector / GROUP_SECTORS;
+      size_t group_left = (group + 1) * GROUP_SECTORS - sector;
+      size_t n = cnt < group_left ? cnt : group_left;
+
+      if (allocated)
+        group_free[group] -= n;
+      else
+        group_free[group] += n;
+      sector += n;
+      cnt -= n;
+    }
+}
+
+/* Marks the sectors of the free map file that hold the bits for
+   the CNT sectors starting at SECTOR as needing to be written.
+   Must be called with free_map_lock held. */
+static void
+mark_dirty (block_sector_t sector, size_t cnt) 
+{
+  size_t first = sector / BITS_PER_SECTOR;
+  size_t last = (sector + cnt - 1) / BITS_PER_SECTOR;
+
+  bitmap_set_multiple (dirty_map, first, last - first + 1, true);
+}
+
+/* Writes the sectors of the free map that have changed since
+   they were last written to the free map file.  (Like any file
+   write, this puts them in the buffer cache, to reach disk at
+   its next flush.) */
+void
+free_map_flush (void) 
+{
+  size_t file_size = bitmap_file_size (free_map);
+  size_t idx = 0;
+
+  lock_acquire (&free_map_lock);
+  if (free_map_file != NULL)
+    while ((idx = bitmap_scan (dirty_map, idx, 1, true)) != BITMAP_ERROR) 
+      {
+        size_t ofs = idx * BLOCK_SECTOR_SIZE;
+        size_t size = file_size - ofs;
+
+        if (size > BLOCK_SECTOR_SIZE)
+          size = BLOCK_SECTOR_SIZE;
+        if (!bitmap_write_part (free_map, free_map_file, ofs, size))
+          PANIC ("can't write free map");
+        bitmap_reset (dirty_map, idx);
+      }
+  lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -58,13 +244,20 @@ free_map_open (void)
     PANIC ("can't open free map");
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  bitmap_set_all (dirty_map, false);
+  count_group_free ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) 
 {
+  free_map_flush ();
+
+  lock_acquire (&free_map_lock);
   file_close (free_map_file);
+  free_map_file = NULL;
+  lock_release (&free_map_lock);
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -73,13 +266,18 @@ void
 free_map_create (void) 
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
     PANIC ("free map creation failed");
 
-  /* Write bitmap to file. */
+  /* Write bitmap to file.  Creating the file allocated sectors,
+     which are in the free map but not yet in the file, so write
+     all of it. */
+  lock_acquire (&free_map_lock);
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+  bitmap_set_all (dirty_map, false);
+  lock_release (&free_map_lock);
 }
@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,10 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Number of sectors of file data that fsutil_extract() reads
+   from the scratch device at a time. */
+#define EXTRACT_SECTORS 128
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -79,7 +84,7 @@ fsutil_extract (char **argv UNUSED)
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = malloc (EXTRACT_SECTORS * BLOCK_SECTOR_SIZE);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -124,13 +129,20 @@ fsutil_extract (char **argv UNUSED)
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, reading up to EXTRACT_SECTORS sectors with
+             each request. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
-                                : size);
-              block_read (src, sector++, data);
+              size_t sector_cnt = DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+              int chunk_size;
+
+              if (sector_cnt > EXTRACT_SECTORS)
+                sector_cnt = EXTRACT_SECTORS;
+              chunk_size = (size > (int) (sector_cnt * BLOCK_SECTOR_SIZE)
+                            ? (int) (sector_cnt * BLOCK_SECTOR_SIZE)
+                            : size);
+              block_read_multiple (src, sector, sector_cnt, data);
+              sector += sector_cnt;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
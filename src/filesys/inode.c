@@ -3,31 +3,47 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Sector index.  An inode's sectors[] array holds DIRECT_CNT
+   pointers to data sectors, then a pointer to an indirect sector
+   of PTRS_PER_SECTOR data sector pointers, then a pointer to a
+   doubly indirect sector of PTRS_PER_SECTOR indirect sector
+   pointers.  A pointer of 0 means that no sector is allocated
+   there, which for data is a hole that reads as zeros.  (Sector
+   0 holds the free map's inode, so it is never pointed to.) */
+#define DIRECT_CNT 123
+#define INDIRECT_IDX DIRECT_CNT
+#define DBL_INDIRECT_IDX (DIRECT_CNT + 1)
+#define SECTOR_CNT (DIRECT_CNT + 2)
+#define PTRS_PER_SECTOR ((off_t) (BLOCK_SECTOR_SIZE / sizeof (block_sector_t)))
+
+/* Maximum length of an inode's data, a little over 8 MB. */
+#define INODE_SPAN ((DIRECT_CNT + PTRS_PER_SECTOR                     \
+                     + PTRS_PER_SECTOR * PTRS_PER_SECTOR)             \
+                    * BLOCK_SECTOR_SIZE)
+
+/* Most sectors that inode_read_at() reads with one request. */
+#define READ_RUN_MAX 128
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
+    block_sector_t sectors[SECTOR_CNT]; /* Sector index. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    uint32_t is_dir;                    /* Nonzero for a directory. */
   };
 
-/* Returns the number of sectors to allocate for an inode SIZE
-   bytes long. */
-static inline size_t
-bytes_to_sectors (off_t size)
-{
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
-}
-
 /* In-memory inode. */
 struct inode 
   {
@@ -39,38 +55,159 @@ struct inode
     struct inode_disk data;             /* Inode content. */
   };
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/* Allocates a sector as close after *NEAR as possible, fills
+   it with zeros, and stores its number into *SECTORP and *NEAR.
+   Returns true if successful, false if the disk is full. */
+static bool
+allocate_zeroed (block_sector_t *sectorp, block_sector_t *near) 
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+
+  if (!free_map_allocate (1, *near, sectorp))
+    return false;
+  *near = *sectorp;
+  cache_write (*sectorp, zeros, 0, BLOCK_SECTOR_SIZE);
+  return true;
+}
+
+/* Returns the sector that holds byte offset POS within the data
+   described by DISK_INODE, or 0 if no sector is allocated there.
+
+   If NEAR is non-null, then instead of returning 0, allocates
+   the data sector, and any indirect sectors needed to reach it,
+   as zeroed sectors, placing each as close after *NEAR and then
+   the one before it as possible, and sets *NEAR to the sector
+   returned.  Returns 0 in that case only if POS is beyond
+   INODE_SPAN or the disk is full.  Allocations
+   recorded in DISK_INODE itself are made only in memory; if
+   there are any, sets *CHANGED to true, and the caller must
+   write DISK_INODE back to disk. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+index_lookup (struct inode_disk *disk_inode, off_t pos, block_sector_t *near,
+              bool *changed) 
 {
-  ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+  off_t idx = pos / BLOCK_SECTOR_SIZE;
+  off_t path[3];
+  int depth, level;
+  block_sector_t *slot;
+  block_sector_t sector;
+
+  ASSERT (pos >= 0);
+
+  /* Find the path through the index to the data sector. */
+  if (idx < DIRECT_CNT) 
+    {
+      path[0] = idx;
+      depth = 1;
+    }
+  else if ((idx -= DIRECT_CNT) < PTRS_PER_SECTOR) 
+    {
+      path[0] = INDIRECT_IDX;
+      path[1] = idx;
+      depth = 2;
+    }
+  else if ((idx -= PTRS_PER_SECTOR) < PTRS_PER_SECTOR * PTRS_PER_SECTOR) 
+    {
+      path[0] = DBL_INDIRECT_IDX;
+      path[1] = idx / PTRS_PER_SECTOR;
+      path[2] = idx % PTRS_PER_SECTOR;
+      depth = 3;
+    }
   else
-    return -1;
+    return 0;
+
+  /* Follow it, allocating as we go if requested.  Each new
+     sector is zeroed before it is linked in, since reads do not
+     hold filesys_lock and may follow the link at any time. */
+  slot = &disk_inode->sectors[path[0]];
+  sector = *slot;
+  if (sector == 0) 
+    {
+      if (near == NULL || !allocate_zeroed (&sector, near))
+        return 0;
+      *slot = sector;
+      *changed = true;
+    }
+  for (level = 1; level < depth; level++) 
+    {
+      off_t ofs = path[level] * sizeof (block_sector_t);
+      block_sector_t next;
+
+      cache_read (sector, &next, ofs, sizeof next);
+      if (next == 0) 
+        {
+          if (near == NULL || !allocate_zeroed (&next, near))
+            return 0;
+          cache_write (sector, &next, ofs, sizeof next);
+        }
+      sector = next;
+    }
+  if (near != NULL)
+    *near = sector;
+  return sector;
+}
+
+/* Releases SECTOR, if it is allocated.  If LEVEL is nonzero,
+   SECTOR is an indirect sector LEVEL levels above the data, and
+   all of the sectors it points to are released too. */
+static void
+release_sectors (block_sector_t sector, int level) 
+{
+  if (sector == 0)
+    return;
+
+  if (level > 0) 
+    {
+      off_t i;
+
+      for (i = 0; i < PTRS_PER_SECTOR; i++) 
+        {
+          block_sector_t ptr;
+          cache_read (sector, &ptr, i * sizeof ptr, sizeof ptr);
+          release_sectors (ptr, level - 1);
+        }
+    }
+  free_map_release (sector, 1);
+}
+
+/* Releases all of the sectors indexed by DISK_INODE. */
+static void
+release_index (const struct inode_disk *disk_inode) 
+{
+  int i;
+
+  for (i = 0; i < DIRECT_CNT; i++)
+    release_sectors (disk_inode->sectors[i], 0);
+  release_sectors (disk_inode->sectors[INDIRECT_IDX], 1);
+  release_sectors (disk_inode->sectors[DBL_INDIRECT_IDX], 2);
 }
 
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of struct inode. */
+static struct kmem_cache *inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode), 0, NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The inode is a directory if IS_DIR is true, otherwise
+   an ordinary file.  The data sectors are allocated and zeroed now, so
+   that writes within LENGTH never need to allocate.  (The free
+   map depends on this, because it cannot allocate sectors while
+   writing itself out.)
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
-inode_create (block_sector_t sector, off_t length)
+inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -81,25 +218,30 @@ inode_create (block_sector_t sector, off_t length)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
+  if (length > INODE_SPAN)
+    return false;
+
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
+      block_sector_t near = sector;
+      bool changed = false;
+      off_t ofs;
+
       disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
+      disk_inode->is_dir = is_dir;
+      success = true;
+      for (ofs = 0; ofs < length; ofs += BLOCK_SECTOR_SIZE)
+        if (index_lookup (disk_inode, ofs, &near, &changed) == 0) 
+          {
+            success = false;
+            break;
+          }
+      if (success)
+        cache_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
+      else
+        release_index (disk_inode);
       free (disk_inode);
     }
   return success;
@@ -127,7 +269,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -137,7 +279,7 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  cache_read (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
   return inode;
 }
 
@@ -157,6 +299,21 @@ inode_get_inumber (const struct inode *inode)
   return inode->sector;
 }
 
+/* Returns true if INODE is a directory, false if it is an
+   ordinary file. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->data.is_dir != 0;
+}
+
+/* Returns the number of openers of INODE. */
+int
+inode_open_cnt (const struct inode *inode)
+{
+  return inode->open_cnt;
+}
+
 /* Closes INODE and writes it to disk.
    If this was the last reference to INODE, frees its memory.
    If INODE was also a removed inode, frees its blocks. */
@@ -177,11 +334,10 @@ inode_close (struct inode *inode)
       if (inode->removed) 
         {
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          release_index (&inode->data);
         }
 
-      free (inode); 
+      kmem_cache_free (inode_cache, inode); 
     }
 }
 
@@ -194,24 +350,55 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Returns the number of consecutive disk sectors, starting with
+   SECTOR at byte offset POS in INODE, that hold INODE's data
+   from POS onward, up to MAX_CNT or READ_RUN_MAX, whichever is
+   less.  SECTOR itself is always counted. */
+static size_t
+sector_run (struct inode *inode, off_t pos, block_sector_t sector,
+            size_t max_cnt) 
+{
+  size_t cnt = 1;
+
+  if (max_cnt > READ_RUN_MAX)
+    max_cnt = READ_RUN_MAX;
+  while (cnt < max_cnt
+         && index_lookup (&inode->data, pos + cnt * BLOCK_SECTOR_SIZE,
+                          NULL, NULL) == sector + cnt)
+    cnt++;
+  return cnt;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
+   than SIZE if an error occurs or end of file is reached.
+   Holes in the file read as zeros.  Whole sectors that are
+   consecutive on disk are read together.  Also asks for the
+   sector following the last one read to be fetched in the
+   background, in anticipation of a sequential read.
+
+   Reads do not hold filesys_lock, so a write may extend INODE
+   meanwhile.  inode_write_at() links in each new sector before
+   it raises the length, so we read the length first: every
+   sector below it is then already in the index, and none of it
+   reads as a hole by mistake. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+  off_t length = inode_length (inode);
 
+  barrier ();
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx = index_lookup (&inode->data, offset,
+                                                NULL, NULL);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -220,59 +407,77 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_idx == 0)
+        memset (buffer + bytes_read, 0, chunk_size);
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) 
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          /* Read whole sectors that lie consecutively on disk as
+             a single request. */
+          off_t whole_left = (size < inode_left ? size : inode_left);
+          size_t cnt = sector_run (inode, offset, sector_idx,
+                                   whole_left / BLOCK_SECTOR_SIZE);
+          cache_read_multiple (sector_idx, cnt, buffer + bytes_read);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
+      else
+        cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+
+  if (bytes_read > 0) 
+    {
+      off_t next = ROUND_UP (offset, BLOCK_SECTOR_SIZE);
+      if (next < length) 
+        {
+          block_sector_t next_sector = index_lookup (&inode->data, next,
+                                                     NULL, NULL);
+          if (next_sector != 0)
+            cache_readahead (next_sector);
+        }
+    }
 
   return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the maximum file size is reached or the
+   disk is full.  Writing past end of file extends the inode,
+   allocating sectors only for the data actually written, so
+   that any gap left behind is a hole. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  bool changed = false;
+  block_sector_t near;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  /* Place any new sectors just after the data before OFFSET, or
+     if there is none, after the inode itself. */
+  near = 0;
+  if (offset >= BLOCK_SECTOR_SIZE)
+    near = index_lookup (&inode->data, offset - BLOCK_SECTOR_SIZE,
+                         NULL, NULL);
+  if (near == 0)
+    near = inode->sector;
+
   while (size > 0) 
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Bytes left before maximum file size, bytes left in
+         sector, lesser of the two. */
+      off_t inode_left = INODE_SPAN - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -281,38 +486,29 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      /* Sector to write, allocated if necessary. */
+      sector_idx = index_lookup (&inode->data, offset, &near, &changed);
+      if (sector_idx == 0)
+        break;
+
+      cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+                   chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+
+  /* Extend the file if we wrote past its end.  This must follow
+     linking in the new sectors; see inode_read_at(). */
+  if (bytes_written > 0 && offset > inode->data.length) 
+    {
+      inode->data.length = offset;
+      changed = true;
+    }
+  if (changed)
+    cache_write (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
 
   return bytes_written;
 }
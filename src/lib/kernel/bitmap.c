@@ -359,6 +359,18 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the SIZE bytes starting at byte offset OFS of B's file
+   image to the same offset in FILE.  Return true if successful,
+   false otherwise. */
+bool
+bitmap_write_part (const struct bitmap *b, struct file *file,
+                   size_t ofs, size_t size) 
+{
+  ASSERT (ofs + size <= byte_cnt (b->bit_cnt));
+  return (file_write_at (file, (const uint8_t *) b->bits + ofs, size, ofs)
+          == (off_t) size);
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -1,6 +1,7 @@
 #include <console.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/serial.h"
 #include "devices/vga.h"
 #include "threads/init.h"
@@ -9,6 +10,7 @@
 
 static void vprintf_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void putbuf_have_lock (const char *, size_t);
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -119,19 +121,33 @@ console_locked_by_current_thread (void)
           || lock_held_by_current_thread (&console_lock));
 }
 
+/* Output buffered by vprintf() on its way to the console, so
+   that it reaches the serial layer in pieces rather than one
+   character at a time. */
+struct vprintf_aux 
+  {
+    char buf[64];               /* Characters not yet written. */
+    size_t len;                 /* Number of characters in BUF. */
+    int char_cnt;               /* Total number of characters. */
+  };
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list.
    Writes its output to both vga display and serial port. */
 int
 vprintf (const char *format, va_list args) 
 {
-  int char_cnt = 0;
+  struct vprintf_aux aux;
+
+  aux.len = 0;
+  aux.char_cnt = 0;
 
   acquire_console ();
-  __vprintf (format, args, vprintf_helper, &char_cnt);
+  __vprintf (format, args, vprintf_helper, &aux);
+  putbuf_have_lock (aux.buf, aux.len);
   release_console ();
 
-  return char_cnt;
+  return aux.char_cnt;
 }
 
 /* Writes string S to the console, followed by a new-line
@@ -140,8 +156,7 @@ int
 puts (const char *s) 
 {
   acquire_console ();
-  while (*s != '\0')
-    putchar_have_lock (*s++);
+  putbuf_have_lock (s, strlen (s));
   putchar_have_lock ('\n');
   release_console ();
 
@@ -153,8 +168,7 @@ void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  putbuf_have_lock (buffer, n);
   release_console ();
 }
 
@@ -171,11 +185,17 @@ putchar (int c)
 
 /* Helper function for vprintf(). */
 static void
-vprintf_helper (char c, void *char_cnt_) 
+vprintf_helper (char c, void *aux_) 
 {
-  int *char_cnt = char_cnt_;
-  (*char_cnt)++;
-  putchar_have_lock (c);
+  struct vprintf_aux *aux = aux_;
+
+  aux->char_cnt++;
+  aux->buf[aux->len++] = c;
+  if (aux->len >= sizeof aux->buf) 
+    {
+      putbuf_have_lock (aux->buf, aux->len);
+      aux->len = 0;
+    }
 }
 
 /* Writes C to the vga display and serial port.
@@ -189,3 +209,16 @@ putchar_have_lock (uint8_t c)
   serial_putc (c);
   vga_putc (c);
 }
+
+/* Writes the N characters in BUFFER to the vga display and
+   serial port.  The caller has already acquired the console lock
+   if appropriate. */
+static void
+putbuf_have_lock (const char *buffer, size_t n) 
+{
+  ASSERT (console_locked_by_current_thread ());
+  write_cnt += n;
+  serial_write (buffer, n);
+  while (n-- > 0)
+    vga_putc (*buffer++);
+}
@@ -1,5 +1,27 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The block functions below, memcpy() and friends, move data a
+   32-bit word at a time where they can.  Blocks of at least
+   REP_MIN bytes are moved with the x86 string instructions,
+   whose startup cost is repaid only on longer blocks; shorter
+   ones use a word loop when both blocks are word-aligned and a
+   byte loop otherwise.  The word loops access the blocks through
+   uint32_t pointers, which is safe only because Make.config
+   turns off -fstrict-aliasing. */
+#define REP_MIN 64
+
+/* Size of a word. */
+#define WORD_SIZE sizeof (uint32_t)
+
+/* Returns true if P is word-aligned. */
+static inline bool
+is_word_aligned (const void *p) 
+{
+  return (uintptr_t) p % WORD_SIZE == 0;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +34,31 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= REP_MIN) 
+    {
+      /* Align DST, then copy words with "rep movsl", which is
+         fast whether or not SRC ends up aligned too. */
+      size_t word_cnt;
+
+      while (!is_word_aligned (dst)) 
+        {
+          *dst++ = *src++;
+          size--;
+        }
+      word_cnt = size / WORD_SIZE;
+      size %= WORD_SIZE;
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (word_cnt)
+                    : : "memory");
+    }
+  else if (is_word_aligned (dst) && is_word_aligned (src)) 
+    for (; size >= WORD_SIZE; size -= WORD_SIZE) 
+      {
+        *(uint32_t *) dst = *(const uint32_t *) src;
+        dst += WORD_SIZE;
+        src += WORD_SIZE;
+      }
+
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -29,20 +76,50 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
+  /* Copying upward is safe unless DST lies within SRC. */
+  if (dst <= src || dst >= src + size)
+    return memcpy (dst_, src_, size);
+
+  /* Copy downward from the end. */
+  dst += size;
+  src += size;
+  if (size >= REP_MIN) 
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
+      /* Align the end of DST, then copy words downward with
+         "rep movsl" with the direction flag set.  The flag must
+         be clear again before anything else runs; the interrupt
+         entry code clears it for handlers. */
+      size_t word_cnt;
+      unsigned char *d;
+      const unsigned char *s;
+
+      while (!is_word_aligned (dst)) 
+        {
+          *--dst = *--src;
+          size--;
+        }
+      word_cnt = size / WORD_SIZE;
+      size %= WORD_SIZE;
+      dst -= word_cnt * WORD_SIZE;
+      src -= word_cnt * WORD_SIZE;
+      d = dst + (word_cnt - 1) * WORD_SIZE;
+      s = src + (word_cnt - 1) * WORD_SIZE;
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (d), "+S" (s), "+c" (word_cnt)
+                    : : "memory", "cc");
     }
+  else if (is_word_aligned (dst) && is_word_aligned (src)) 
+    for (; size >= WORD_SIZE; size -= WORD_SIZE) 
+      {
+        dst -= WORD_SIZE;
+        src -= WORD_SIZE;
+        *(uint32_t *) dst = *(const uint32_t *) src;
+      }
+
+  while (size-- > 0)
+    *--dst = *--src;
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +135,18 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip over equal words, if both blocks are aligned.  The byte
+     loop then finds the difference within the first unequal
+     word, if any, since words are little-endian. */
+  if (is_word_aligned (a) && is_word_aligned (b))
+    for (; size >= WORD_SIZE; size -= WORD_SIZE) 
+      {
+        if (*(const uint32_t *) a != *(const uint32_t *) b)
+          break;
+        a += WORD_SIZE;
+        b += WORD_SIZE;
+      }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,7 +370,32 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  if (size >= WORD_SIZE) 
+    {
+      uint32_t word = (unsigned char) value * 0x01010101u;
+      size_t word_cnt;
+
+      while (!is_word_aligned (dst)) 
+        {
+          *dst++ = value;
+          size--;
+        }
+      word_cnt = size / WORD_SIZE;
+      size %= WORD_SIZE;
+      if (word_cnt * WORD_SIZE >= REP_MIN)
+        asm volatile ("rep stosl"
+                      : "+D" (dst), "+c" (word_cnt)
+                      : "a" (word)
+                      : "memory");
+      else
+        for (; word_cnt > 0; word_cnt--) 
+          {
+            *(uint32_t *) dst = word;
+            dst += WORD_SIZE;
+          }
+    }
+
   while (size-- > 0)
     *dst++ = value;
 
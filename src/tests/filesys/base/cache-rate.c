@@ -0,0 +1,52 @@
+/* Writes a 16-sector file, then reads it back sequentially many
+   times, one sector-sized block at a time.  The file fits in the
+   buffer cache, so nearly every read after the first pass should
+   be a cache hit.  The kernel's buffer cache and block device
+   statistics, printed at shutdown, show the hit rate and how
+   many sectors actually went to and from disk. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 8192
+#define BLOCK_SIZE 512
+#define PASS_CNT 64
+
+static char buf[FILE_SIZE];
+static char block[BLOCK_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "cached";
+  int fd;
+  int pass;
+  size_t ofs;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  if (write (fd, buf, sizeof buf) != (int) sizeof buf)
+    fail ("write %zu bytes to \"%s\" failed", sizeof buf, file_name);
+
+  msg ("read \"%s\" %d times", file_name, PASS_CNT);
+  for (pass = 0; pass < PASS_CNT; pass++) 
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < sizeof buf; ofs += BLOCK_SIZE) 
+        {
+          if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+            fail ("read %d bytes at offset %zu in \"%s\" failed",
+                  BLOCK_SIZE, ofs, file_name);
+          compare_bytes (block, buf + ofs, BLOCK_SIZE, ofs, file_name);
+        }
+    }
+  msg ("%d sector reads issued", PASS_CNT * FILE_SIZE / BLOCK_SIZE);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
@@ -0,0 +1,47 @@
+# -*- perl -*-
+
+# The expected output looks like this, followed at shutdown by
+# the kernel's statistics, whose numbers vary from run to run:
+#
+# (cache-rate) begin
+# (cache-rate) create "cached"
+# (cache-rate) open "cached"
+# (cache-rate) read "cached" 64 times
+# (cache-rate) 1024 sector reads issued
+# (cache-rate) close "cached"
+# (cache-rate) end
+# ...
+# Buffer cache: 1203 hits, 180 misses (86% hit rate), 12 read-aheads
+# hd0:0 (kernel): 0 reads, 0 writes
+# hd1:0 (filesys): 205 reads, 260 writes
+#
+# The 1024 sector reads of the test file should nearly all be
+# cache hits, so the overall hit rate should be high and the
+# file system device should see far fewer reads than that.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "Test did not finish reading.\n"
+  if !grep (/^\(cache-rate\) 1024 sector reads issued$/, @output);
+
+my ($hits, $misses, $rate)
+  = map (/^Buffer cache: (\d+) hits, (\d+) misses \((\d+)% hit rate\)/,
+	 @output);
+fail "No buffer cache statistics found in output.\n" if !defined $rate;
+fail "Hit rate was only $rate% ($hits hits, $misses misses).\n"
+  if $rate < 75;
+
+my ($reads) = map (/\(filesys\): (\d+) reads, \d+ writes/, @output);
+fail "No file system device statistics found in output.\n"
+  if !defined $reads;
+fail "File system device saw $reads reads for 1024 cached sector reads.\n"
+  if $reads >= 512;
+
+pass;
@@ -0,0 +1,61 @@
+/* Child process for rand-read test.
+   Reads READ_CNT sectors at random from the test file, checking
+   that each holds its own sector number, and writes the number
+   of cycles that each read took to a file named "lat<N>", where
+   N is the child's index, followed by the timestamps at which
+   the first read started and the last read finished. */
+
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/rand-read.h"
+
+static uint32_t sector[SECTOR_SIZE / sizeof (uint32_t)];
+static uint64_t latencies[READ_CNT + 2];
+
+int
+main (int argc, const char *argv[]) 
+{
+  char lat_name[16];
+  int child_idx;
+  int fd;
+  size_t i;
+
+  test_name = "child-rand-read";
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  random_init (child_idx + 1);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  latencies[READ_CNT] = rdtsc ();
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      unsigned sector_idx = random_ulong () % SECTOR_CNT;
+      uint64_t start;
+
+      seek (fd, sector_idx * SECTOR_SIZE);
+      start = rdtsc ();
+      CHECK (read (fd, sector, sizeof sector) == (int) sizeof sector,
+             "read sector %u of \"%s\"", sector_idx, file_name);
+      latencies[i] = rdtsc () - start;
+      if (sector[0] != sector_idx
+          || sector[sizeof sector / sizeof *sector - 1] != sector_idx)
+        fail ("sector %u of \"%s\" holds wrong data", sector_idx, file_name);
+    }
+  latencies[READ_CNT + 1] = rdtsc ();
+  close (fd);
+
+  snprintf (lat_name, sizeof lat_name, "lat%d", child_idx);
+  CHECK (create (lat_name, 0), "create \"%s\"", lat_name);
+  CHECK ((fd = open (lat_name)) > 1, "open \"%s\"", lat_name);
+  CHECK (write (fd, latencies, sizeof latencies) == (int) sizeof latencies,
+         "write \"%s\"", lat_name);
+  close (fd);
+
+  return child_idx;
+}
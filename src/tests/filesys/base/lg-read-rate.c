@@ -0,0 +1,53 @@
+/* Writes a 64 kB file, then reads it back whole many times, and
+   reports the average number of CPU cycles per read, as
+   measured by the timestamp counter.  The file's sectors lie
+   consecutively on disk, so the kernel can read those that are
+   not cached with a few multi-sector requests instead of one
+   request per sector; the block device statistics printed at
+   shutdown show how many requests were made. */
+
+#include <random.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 65536
+#define PASS_CNT 16
+
+static char buf[FILE_SIZE];
+static char copy[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "large";
+  uint64_t start, cycles;
+  int fd;
+  int pass;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  if (write (fd, buf, sizeof buf) != (int) sizeof buf)
+    fail ("write %zu bytes to \"%s\" failed", sizeof buf, file_name);
+
+  msg ("read \"%s\" %d times", file_name, PASS_CNT);
+  cycles = 0;
+  for (pass = 0; pass < PASS_CNT; pass++) 
+    {
+      seek (fd, 0);
+      start = rdtsc ();
+      if (read (fd, copy, sizeof copy) != (int) sizeof copy)
+        fail ("read %zu bytes from \"%s\" failed", sizeof copy, file_name);
+      cycles += rdtsc () - start;
+      compare_bytes (copy, buf, sizeof buf, 0, file_name);
+    }
+  msg ("%d reads of %d bytes: %llu cycles per read",
+       PASS_CNT, FILE_SIZE, cycles / PASS_CNT);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
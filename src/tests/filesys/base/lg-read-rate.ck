@@ -0,0 +1,42 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle count
+# varying from machine to machine and run to run, followed at
+# shutdown by the kernel's statistics:
+#
+# (lg-read-rate) begin
+# (lg-read-rate) create "large"
+# (lg-read-rate) open "large"
+# (lg-read-rate) read "large" 16 times
+# (lg-read-rate) 16 reads of 65536 bytes: 1234567 cycles per read
+# (lg-read-rate) close "large"
+# (lg-read-rate) end
+# ...
+# hd1:0 (filesys): 1405 reads, 297 writes, 339 requests
+#
+# Nearly all of the 2048 sectors read from the test file should
+# reach the disk in multi-sector requests, so the file system
+# device should see far fewer requests than sectors.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "No per-read cycle count found in output.\n"
+  if !grep (/^\(lg-read-rate\) 16 reads of 65536 bytes: \d+ cycles per read$/,
+	    @output);
+
+my ($reads, $writes, $requests)
+  = map (/\(filesys\): (\d+) reads, (\d+) writes, (\d+) requests/, @output);
+fail "No file system device statistics found in output.\n"
+  if !defined $requests;
+fail "File system device saw $requests requests "
+  . "for $reads sectors read and $writes written.\n"
+  if $requests * 2 > $reads + $writes;
+
+pass;
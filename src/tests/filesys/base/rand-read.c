@@ -0,0 +1,92 @@
+/* Spawns several child processes that each read single sectors
+   at random from a 512 kB file, far larger than the buffer
+   cache, so that their requests reach the disk at the same time
+   and the disk scheduler has several to choose among.  Each
+   child writes the latency of each of its reads, in CPU cycles,
+   to a file of its own.  Once they are done, reports the mean
+   and 99th percentile latency over all of the reads, and the
+   throughput from the first read's start to the last read's
+   end. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/rand-read.h"
+
+static uint32_t sector[SECTOR_SIZE / sizeof (uint32_t)];
+static uint64_t latencies[CHILD_CNT * READ_CNT];
+
+/* Compares the uint64_t values that A and B point to, for
+   qsort(). */
+static int
+compare_latencies (const void *a_, const void *b_) 
+{
+  const uint64_t *a = a_;
+  const uint64_t *b = b_;
+
+  return *a < *b ? -1 : *a > *b;
+}
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  uint64_t first = UINT64_MAX, last = 0;
+  uint64_t total;
+  size_t i, j;
+  int fd;
+
+  /* Fill each sector of the file with its own number, so that
+     the children can tell that they read the right one. */
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("write %d sectors to \"%s\"", SECTOR_CNT, file_name);
+  for (i = 0; i < SECTOR_CNT; i++) 
+    {
+      for (j = 0; j < sizeof sector / sizeof *sector; j++)
+        sector[j] = i;
+      if (write (fd, sector, sizeof sector) != (int) sizeof sector)
+        fail ("write sector %zu of \"%s\" failed", i, file_name);
+    }
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  exec_children ("child-rand-read", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+
+  /* Gather the children's latencies. */
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      char lat_name[16];
+      size_t size = READ_CNT * sizeof *latencies;
+      uint64_t span[2];
+
+      snprintf (lat_name, sizeof lat_name, "lat%zu", i);
+      CHECK ((fd = open (lat_name)) > 1, "open \"%s\"", lat_name);
+      if (read (fd, latencies + i * READ_CNT, size) != (int) size
+          || read (fd, span, sizeof span) != (int) sizeof span)
+        fail ("read \"%s\" failed", lat_name);
+      close (fd);
+
+      if (span[0] < first)
+        first = span[0];
+      if (span[1] > last)
+        last = span[1];
+    }
+
+  total = 0;
+  for (i = 0; i < CHILD_CNT * READ_CNT; i++)
+    total += latencies[i];
+  qsort (latencies, CHILD_CNT * READ_CNT, sizeof *latencies,
+         compare_latencies);
+  msg ("%d reads by %d processes: %llu cycles mean, %llu cycles p99",
+       CHILD_CNT * READ_CNT, CHILD_CNT, total / (CHILD_CNT * READ_CNT),
+       latencies[CHILD_CNT * READ_CNT * 99 / 100]);
+  msg ("%d bytes in %llu cycles: %llu bytes per million cycles",
+       CHILD_CNT * READ_CNT * SECTOR_SIZE, last - first,
+       (uint64_t) CHILD_CNT * READ_CNT * SECTOR_SIZE * 1000000
+       / (last - first + 1));
+}
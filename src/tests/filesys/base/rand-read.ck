@@ -0,0 +1,50 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle counts
+# varying from machine to machine and run to run:
+#
+# (rand-read) begin
+# (rand-read) create "data"
+# (rand-read) open "data"
+# (rand-read) write 1024 sectors to "data"
+# (rand-read) close "data"
+# (rand-read) exec child 1 of 4: "child-rand-read 0"
+# ...
+# (rand-read) wait for child 4 of 4 returned 3 (expected 3)
+# (rand-read) open "lat0"
+# ...
+# (rand-read) 256 reads by 4 processes: 1234567 cycles mean, 2345678 cycles p99
+# (rand-read) 131072 bytes in 98765432 cycles: 1327 bytes per million cycles
+# (rand-read) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "No latency summary found in output.\n"
+  if !grep (/^\(rand-read\) 256 reads by 4 processes: \d+ cycles mean, \d+ cycles p99$/,
+	    @output);
+fail "No throughput found in output.\n"
+  if !grep (/^\(rand-read\) 131072 bytes in \d+ cycles: \d+ bytes per million cycles$/,
+	    @output);
+
+my (@expected) = ('(rand-read) begin',
+		  '(rand-read) create "data"',
+		  '(rand-read) open "data"',
+		  '(rand-read) write 1024 sectors to "data"',
+		  '(rand-read) close "data"',
+		  map ("(rand-read) exec child " . ($_ + 1)
+		       . " of 4: \"child-rand-read $_\"", 0...3),
+		  map ("(rand-read) wait for child " . ($_ + 1)
+		       . " of 4 returned $_ (expected $_)", 0...3),
+		  map ("(rand-read) open \"lat$_\"", 0...3));
+my (@actual) = grep (/^\(rand-read\) / && !/cycles/ && !/end$/, @output);
+fail "Unexpected output:\n  " . join ("\n  ", @actual) . "\n"
+  if join ("\n", @actual) ne join ("\n", @expected);
+
+pass;
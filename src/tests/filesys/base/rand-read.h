@@ -0,0 +1,11 @@
+#ifndef TESTS_FILESYS_BASE_RAND_READ_H
+#define TESTS_FILESYS_BASE_RAND_READ_H
+
+#define SECTOR_SIZE 512         /* Bytes per read. */
+#define SECTOR_CNT 1024         /* Sectors in the data file. */
+#define READ_CNT 64             /* Reads made by each child. */
+#define CHILD_CNT 4             /* Number of reading children. */
+
+static const char file_name[] = "data";
+
+#endif /* tests/filesys/base/rand-read.h */
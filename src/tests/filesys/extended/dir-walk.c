@@ -0,0 +1,38 @@
+/* Creates a chain of nested directories with a file at the
+   bottom, then opens the file by its absolute path many times.
+   Every open walks the whole chain, so the lookups should be
+   served by the kernel's dentry cache, whose statistics are
+   printed at shutdown, rather than by reading the directories. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DEPTH 6
+#define WALK_CNT 200
+
+void
+test_main (void) 
+{
+  char path[64];
+  size_t len = 0;
+  int i;
+
+  for (i = 0; i < DEPTH; i++) 
+    {
+      len += snprintf (path + len, sizeof path - len, "/d%d", i);
+      CHECK (mkdir (path), "mkdir \"%s\"", path);
+    }
+  snprintf (path + len, sizeof path - len, "/file");
+  CHECK (create (path, 0), "create \"%s\"", path);
+
+  msg ("open \"%s\" %d times", path, WALK_CNT);
+  for (i = 0; i < WALK_CNT; i++) 
+    {
+      int fd = open (path);
+      if (fd < 2)
+        fail ("open \"%s\" failed", path);
+      close (fd);
+    }
+}
@@ -0,0 +1,36 @@
+# -*- perl -*-
+
+# The expected output looks like this, followed at shutdown by
+# the kernel's statistics, whose numbers vary from run to run:
+#
+# (dir-walk) begin
+# (dir-walk) mkdir "/d0"
+# ...
+# (dir-walk) mkdir "/d0/d1/d2/d3/d4/d5"
+# (dir-walk) create "/d0/d1/d2/d3/d4/d5/file"
+# (dir-walk) open "/d0/d1/d2/d3/d4/d5/file" 200 times
+# (dir-walk) end
+# ...
+# Dentry cache: 1450 hits, 25 misses
+#
+# Each open looks up 7 path components, so the 200 opens alone
+# should account for at least 1400 dentry cache hits.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "Test did not finish.\n" if !grep ($_ eq '(dir-walk) end', @output);
+
+my ($hits, $misses) = map (/^Dentry cache: (\d+) hits, (\d+) misses$/,
+			   @output);
+fail "No dentry cache statistics found in output.\n" if !defined $hits;
+fail "Only $hits dentry cache hits ($misses misses) for 1400 lookups.\n"
+  if $hits < 1400;
+
+pass;
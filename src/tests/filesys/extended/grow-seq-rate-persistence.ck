@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($data) = random_bytes (204800);
+check_archive ({"grown" => [$data], "preallocated" => [$data]});
+pass;
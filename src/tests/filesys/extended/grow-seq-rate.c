@@ -0,0 +1,66 @@
+/* Measures sequential write throughput on a growing file, in
+   the style of grow-seq-lg, against writes of the same data to a
+   file created at its full size, whose sectors are all
+   allocated up front as with the old contiguous layout.  Reports
+   the average number of CPU cycles, as measured by the timestamp
+   counter, spent per kilobyte written in each case. */
+
+#include <random.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE 204800
+#define BLOCK_SIZE 1234
+
+static char buf[TEST_SIZE];
+
+/* Creates FILE_NAME with INITIAL_SIZE bytes, writes all of BUF
+   to it sequentially, and returns the number of cycles that the
+   writes took. */
+static uint64_t
+time_writes (const char *file_name, size_t initial_size) 
+{
+  uint64_t start, cycles;
+  size_t ofs;
+  int fd;
+
+  CHECK (create (file_name, initial_size), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  start = rdtsc ();
+  for (ofs = 0; ofs < sizeof buf; ofs += BLOCK_SIZE) 
+    {
+      size_t block_size = sizeof buf - ofs;
+      if (block_size > BLOCK_SIZE)
+        block_size = BLOCK_SIZE;
+      if (write (fd, buf + ofs, block_size) != (int) block_size)
+        fail ("write %zu bytes at offset %zu in \"%s\" failed",
+              block_size, ofs, file_name);
+    }
+  cycles = rdtsc () - start;
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  return cycles;
+}
+
+void
+test_main (void) 
+{
+  uint64_t grown, preallocated;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  grown = time_writes ("grown", 0);
+  preallocated = time_writes ("preallocated", sizeof buf);
+
+  check_file ("grown", buf, sizeof buf);
+  check_file ("preallocated", buf, sizeof buf);
+
+  msg ("growing: %llu cycles per kB", grown / (TEST_SIZE / 1024));
+  msg ("preallocated: %llu cycles per kB",
+       preallocated / (TEST_SIZE / 1024));
+}
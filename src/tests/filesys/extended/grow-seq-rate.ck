@@ -0,0 +1,45 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle counts
+# varying from machine to machine and run to run:
+#
+# (grow-seq-rate) begin
+# (grow-seq-rate) create "grown"
+# (grow-seq-rate) open "grown"
+# (grow-seq-rate) close "grown"
+# (grow-seq-rate) create "preallocated"
+# (grow-seq-rate) open "preallocated"
+# (grow-seq-rate) close "preallocated"
+# (grow-seq-rate) open "grown" for verification
+# (grow-seq-rate) verified contents of "grown"
+# (grow-seq-rate) close "grown"
+# (grow-seq-rate) open "preallocated" for verification
+# (grow-seq-rate) verified contents of "preallocated"
+# (grow-seq-rate) close "preallocated"
+# (grow-seq-rate) growing: 51234 cycles per kB
+# (grow-seq-rate) preallocated: 40321 cycles per kB
+# (grow-seq-rate) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+for my $file ("grown", "preallocated") {
+    fail "Contents of \"$file\" were not verified.\n"
+      if !grep ($_ eq "(grow-seq-rate) verified contents of \"$file\"",
+		@output);
+}
+fail "No growing write rate found in output.\n"
+  if !grep (/^\(grow-seq-rate\) growing: \d+ cycles per kB$/, @output);
+fail "No preallocated write rate found in output.\n"
+  if !grep (/^\(grow-seq-rate\) preallocated: \d+ cycles per kB$/,
+	    @output);
+fail "Test did not finish.\n"
+  if !grep ($_ eq '(grow-seq-rate) end', @output);
+
+pass;
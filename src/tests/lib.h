@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <syscall.h>
 
 extern const char *test_name;
@@ -35,6 +36,16 @@ void fail (const char *, ...) PRINTF_FORMAT (1, 2) NO_RETURN;
           }                                     \
         while (0)
 
+/* Reads the processor's timestamp counter, for timing
+   benchmarks. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
 void shuffle (void *, size_t cnt, size_t size);
 
 void exec_children (const char *child_name, pid_t pids[], size_t child_cnt);
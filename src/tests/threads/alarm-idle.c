@@ -0,0 +1,66 @@
+/* Puts many threads to sleep for the same long interval and
+   reports how the timer ticks that pass in the meantime are
+   split between the idle thread and kernel threads.  Sleeping
+   threads should not consume CPU time, so nearly every tick
+   should be counted as idle. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeping threads. */
+#define SLEEPER_CNT 128
+
+/* Number of ticks each thread sleeps. */
+#define SLEEP_TICKS 200
+
+static thread_func sleeper;
+
+void
+test_alarm_idle (void) 
+{
+  struct semaphore done;
+  long long idle_start, kernel_start, user_start;
+  long long idle_end, kernel_end, user_end;
+  long long idle, kernel;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep %d ticks each.",
+       SLEEPER_CNT, SLEEP_TICKS);
+  sema_init (&done, 0);
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT, sleeper, &done);
+    }
+
+  thread_get_stats (&idle_start, &kernel_start, &user_start);
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&done);
+  thread_get_stats (&idle_end, &kernel_end, &user_end);
+
+  idle = idle_end - idle_start;
+  kernel = kernel_end - kernel_start;
+  msg ("All %d threads woke up.", SLEEPER_CNT);
+  msg ("Ticks while sleeping: %lld idle, %lld kernel.", idle, kernel);
+  msg ("Idle share: %lld%%.",
+       idle + kernel > 0 ? idle * 100 / (idle + kernel) : 0);
+}
+
+/* Sleeps for SLEEP_TICKS and then signals the DONE_
+   semaphore. */
+static void
+sleeper (void *done_) 
+{
+  struct semaphore *done = done_;
+
+  timer_sleep (SLEEP_TICKS);
+  sema_up (done);
+}
@@ -0,0 +1,31 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the tick counts and
+# the idle share varying from run to run:
+#
+# (alarm-idle) Creating 128 threads to sleep 200 ticks each.
+# (alarm-idle) All 128 threads woke up.
+# (alarm-idle) Ticks while sleeping: 198 idle, 3 kernel.
+# (alarm-idle) Idle share: 98%.
+#
+# Sleeping threads must not burn CPU time, so at least 90% of the
+# ticks spent waiting should be idle ticks.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "Not all sleepers woke up.\n"
+  if !grep (/All 128 threads woke up\./, @output);
+
+my ($share) = map (/Idle share: (\d+)%\./, @output);
+fail "No idle share found in output.\n" if !defined $share;
+fail "Only $share% of ticks were idle while threads slept.\n"
+  if $share < 90;
+
+pass;
@@ -0,0 +1,122 @@
+/* Measures the page allocator under a mix of allocations and
+   frees of 1 to 64 contiguous kernel pages.  A fixed number of
+   slots each hold at most one block; each step picks a slot at
+   random and either frees its block or allocates a new one of
+   random size.  Reports the mean number of CPU cycles taken by
+   palloc_get_multiple() and palloc_free_multiple(), how many
+   allocations failed, and, as a measure of fragmentation, the
+   largest block that can still be allocated with the surviving
+   blocks in place.  With a buddy allocator the cost per
+   operation should not grow with the size of the pool. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+
+/* Number of blocks that may be allocated at once. */
+#define SLOT_CNT 16
+
+/* Number of allocate-or-free steps. */
+#define STEP_CNT 20000
+
+/* Largest block to allocate, in pages. */
+#define MAX_PAGES 64
+
+/* A block of pages. */
+struct block 
+  {
+    void *pages;                /* First page, or null if none. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+/* Returns a random block size between 1 and MAX_PAGES, skewed
+   toward small blocks the way real requests are. */
+static size_t
+random_page_cnt (void) 
+{
+  int shift = random_ulong () % 7;
+  return random_ulong () % (1u << shift) + 1;
+}
+
+/* Returns the largest number of contiguous pages, up to 1024,
+   that can be allocated from the kernel pool right now. */
+static size_t
+largest_free_block (void) 
+{
+  size_t lo = 0, hi = 1024;
+
+  while (lo < hi) 
+    {
+      size_t mid = (lo + hi + 1) / 2;
+      void *pages = palloc_get_multiple (0, mid);
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, mid);
+          lo = mid;
+        }
+      else
+        hi = mid - 1;
+    }
+  return lo;
+}
+
+void
+test_palloc_buddy (void) 
+{
+  struct block slots[SLOT_CNT];
+  uint64_t alloc_cycles = 0, free_cycles = 0;
+  long alloc_cnt = 0, free_cnt = 0, fail_cnt = 0;
+  size_t live_pages = 0;
+  int i;
+
+  random_init (0);
+  for (i = 0; i < SLOT_CNT; i++)
+    slots[i].pages = NULL;
+
+  msg ("largest free block before: %zu pages.", largest_free_block ());
+
+  for (i = 0; i < STEP_CNT; i++) 
+    {
+      struct block *b = &slots[random_ulong () % SLOT_CNT];
+      uint64_t start;
+
+      if (b->pages != NULL) 
+        {
+          start = rdtsc ();
+          palloc_free_multiple (b->pages, b->page_cnt);
+          free_cycles += rdtsc () - start;
+          free_cnt++;
+          live_pages -= b->page_cnt;
+          b->pages = NULL;
+        }
+      else 
+        {
+          b->page_cnt = random_page_cnt ();
+          start = rdtsc ();
+          b->pages = palloc_get_multiple (0, b->page_cnt);
+          alloc_cycles += rdtsc () - start;
+          alloc_cnt++;
+          if (b->pages != NULL)
+            live_pages += b->page_cnt;
+          else
+            fail_cnt++;
+        }
+    }
+
+  msg ("%ld allocations (%ld failed), %ld frees.",
+       alloc_cnt, fail_cnt, free_cnt);
+  msg ("%llu cycles per allocation, %llu cycles per free.",
+       alloc_cycles / (alloc_cnt > 0 ? alloc_cnt : 1),
+       free_cycles / (free_cnt > 0 ? free_cnt : 1));
+  msg ("largest free block with %zu pages in use: %zu pages.",
+       live_pages, largest_free_block ());
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL)
+      palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+
+  msg ("largest free block after: %zu pages.", largest_free_block ());
+}
@@ -0,0 +1,36 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the numbers varying
+# from run to run:
+#
+# (palloc-buddy) largest free block before: 256 pages.
+# (palloc-buddy) 10012 allocations (0 failed), 9988 frees.
+# (palloc-buddy) 412 cycles per allocation, 1890 cycles per free.
+# (palloc-buddy) largest free block with 160 pages in use: 64 pages.
+# (palloc-buddy) largest free block after: 256 pages.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($before) = map (/largest free block before: (\d+) pages\./, @output);
+my ($after) = map (/largest free block after: (\d+) pages\./, @output);
+fail "Missing largest free block before or after.\n"
+  if !defined $before || !defined $after;
+fail "Freeing every block left fragmentation behind "
+  . "($before pages before, $after after).\n"
+  if $after < $before;
+
+fail "Missing allocation counts.\n"
+  if !grep (/\) \d+ allocations \(\d+ failed\), \d+ frees\./, @output);
+fail "Missing cycle counts.\n"
+  if !grep (/\) \d+ cycles per allocation, \d+ cycles per free\./, @output);
+fail "Missing largest free block while in use.\n"
+  if !grep (/largest free block with \d+ pages in use: \d+ pages\./, @output);
+
+pass;
@@ -0,0 +1,95 @@
+/* Measures how many context switches per second the scheduler
+   sustains with 1, 16, and 256 runnable threads.  Each thread
+   simply yields in a loop for one second, so nearly all of the
+   time goes into thread_yield() and schedule().  With constant
+   time run queues, the rate should barely depend on the number
+   of runnable threads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of ticks that each round of the benchmark lasts. */
+#define ROUND_TICKS TIMER_FREQ
+
+/* Information about one round of the benchmark. */
+struct switch_test 
+  {
+    int64_t end;                /* Tick at which yielders stop. */
+    long long switches;         /* Total number of yields. */
+    struct semaphore done;      /* Upped by each yielder at exit. */
+  };
+
+static thread_func yielder;
+static void measure_switches (int thread_cnt);
+
+void
+test_priority_switch (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  measure_switches (1);
+  measure_switches (16);
+  measure_switches (256);
+}
+
+/* Runs THREAD_CNT yielding threads for ROUND_TICKS ticks and
+   reports the rate of context switches. */
+static void
+measure_switches (int thread_cnt) 
+{
+  struct switch_test test;
+  int64_t start;
+  int i;
+
+  test.switches = 0;
+  sema_init (&test.done, 0);
+
+  /* The yielders have lower priority than us, so none of them
+     runs until we block below. */
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      char name[24];
+      snprintf (name, sizeof name, "yielder %d", i);
+      if (thread_create (name, PRI_DEFAULT - 1, yielder, &test) == TID_ERROR)
+        fail ("couldn't create thread %d of %d", i, thread_cnt);
+    }
+
+  start = timer_ticks ();
+  test.end = start + ROUND_TICKS;
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&test.done);
+
+  msg ("%d threads: %lld switches in %lld ticks (%lld per second).",
+       thread_cnt, test.switches, timer_elapsed (start),
+       test.switches * TIMER_FREQ / timer_elapsed (start));
+}
+
+/* Yields until the round ends, then adds the number of yields
+   to the total. */
+static void
+yielder (void *test_) 
+{
+  struct switch_test *test = test_;
+  enum intr_level old_level;
+  long long switches = 0;
+
+  while (timer_ticks () < test->end) 
+    {
+      thread_yield ();
+      switches++;
+    }
+
+  old_level = intr_disable ();
+  test->switches += switches;
+  intr_set_level (old_level);
+  sema_up (&test->done);
+}
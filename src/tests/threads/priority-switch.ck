@@ -0,0 +1,25 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the counts varying
+# from run to run:
+#
+# (priority-switch) 1 threads: 412345 switches in 100 ticks (412345 per second).
+# (priority-switch) 16 threads: 398765 switches in 101 ticks (394816 per second).
+# (priority-switch) 256 threads: 390123 switches in 101 ticks (386260 per second).
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+foreach my $cnt (1, 16, 256) {
+    fail "No result for $cnt threads.\n"
+      if !grep (/\) $cnt threads: \d+ switches in \d+ ticks \(\d+ per second\)\./,
+		@output);
+}
+
+pass;
@@ -0,0 +1,33 @@
+/* Measures console output throughput by printing 1 MB with
+   printf(), in 64-byte lines, and timing how long it takes for
+   all of it to pass through the serial port.  Nearly all of the
+   time goes into the console and serial layers, so this shows
+   how well they keep the UART's transmit FIFO fed. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/serial.h"
+#include "devices/timer.h"
+
+/* Number of bytes to print. */
+#define TOTAL_BYTES (1024 * 1024)
+
+/* Length of each line, including the new-line. */
+#define LINE_LEN 64
+
+void
+test_serial_printf (void) 
+{
+  int64_t start, elapsed;
+  int i;
+
+  start = timer_ticks ();
+  for (i = 0; i < TOTAL_BYTES / LINE_LEN; i++)
+    printf ("%06d %055d\n", i, 0);
+  serial_flush ();
+  elapsed = timer_elapsed (start);
+
+  msg ("printed %d bytes in %lld ticks (%lld bytes per second).",
+       TOTAL_BYTES, elapsed,
+       (long long) TOTAL_BYTES * TIMER_FREQ / (elapsed > 0 ? elapsed : 1));
+}
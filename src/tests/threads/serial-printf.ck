@@ -0,0 +1,25 @@
+# -*- perl -*-
+
+# The expected output ends like this, with the counts varying
+# from run to run:
+#
+# 016383 0000000000000000000000000000000000000000000000000000000
+# (serial-printf) printed 1048576 bytes in 412 ticks (254508 bytes per second).
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($lines) = scalar (grep (/^\d{6} 0{55}$/, @output));
+fail "Expected 16384 lines of output, got $lines.\n" if $lines != 16384;
+
+fail "No throughput result.\n"
+  if !grep (/\) printed 1048576 bytes in \d+ ticks \(\d+ bytes per second\)\./,
+	    @output);
+
+pass;
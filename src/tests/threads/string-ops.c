@@ -0,0 +1,206 @@
+/* Checks memcpy(), memmove(), memset(), and memcmp() in
+   lib/string.c against simple byte-at-a-time versions, then
+   reports the throughput of each, in MB/s, for several block
+   sizes.
+
+   The checks cover every length from 0 to MAX_CHECK bytes,
+   including the lengths 0 to 3 that never reach a word loop,
+   and every combination of source and destination offset
+   within a word, so that both unaligned heads and unaligned
+   tails are exercised.  memmove() is also checked between
+   overlapping blocks, with the destination both above and
+   below the source, at every distance up to MAX_SHIFT bytes.
+   Each check compares the whole buffer, so that a write just
+   outside the block is caught too. */
+
+#include <random.h>
+#include <stdbool.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+/* Longest block checked. */
+#define MAX_CHECK 300
+
+/* Largest distance between overlapping memmove() blocks. */
+#define MAX_SHIFT 8
+
+/* Size of the buffers used for checking. */
+#define CHECK_SIZE (MAX_CHECK + MAX_SHIFT + 8)
+
+/* Size of the buffers used for timing. */
+#define BENCH_SIZE (8192 + 8)
+
+/* Timer ticks spent timing each function at each size. */
+#define BENCH_TICKS (TIMER_FREQ / 10)
+
+static unsigned char src[CHECK_SIZE];
+static unsigned char dst[CHECK_SIZE];
+static unsigned char expect[CHECK_SIZE];
+
+static unsigned char bench_src[BENCH_SIZE];
+static unsigned char bench_dst[BENCH_SIZE];
+
+static bool matches_expect (void);
+static void check_copy_set_cmp (size_t size, size_t s_ofs, size_t d_ofs);
+static void check_overlap (size_t size, size_t ofs, size_t shift);
+static void benchmark (const char *name, int which);
+
+void
+test_string_ops (void)
+{
+  size_t size, s_ofs, d_ofs, shift;
+
+  random_init (0);
+  random_bytes (src, sizeof src);
+  for (size = 0; size <= MAX_CHECK; size++)
+    for (s_ofs = 0; s_ofs < 4; s_ofs++)
+      for (d_ofs = 0; d_ofs < 4; d_ofs++)
+        check_copy_set_cmp (size, s_ofs, d_ofs);
+  msg ("memcpy, memset, memcmp: lengths 0 to %d at all alignments ok.",
+       MAX_CHECK);
+
+  for (size = 0; size <= MAX_CHECK; size++)
+    for (s_ofs = 0; s_ofs < 4; s_ofs++)
+      for (shift = 0; shift <= MAX_SHIFT; shift++)
+        check_overlap (size, s_ofs, shift);
+  msg ("memmove: lengths 0 to %d, overlapping by up to %d bytes, ok.",
+       MAX_CHECK, MAX_SHIFT);
+
+  benchmark ("memcpy", 0);
+  benchmark ("memmove", 1);
+  benchmark ("memset", 2);
+  benchmark ("memcmp", 3);
+}
+
+/* Returns true if DST and EXPECT are equal, comparing a byte
+   at a time so as not to rely on the memcmp() under test. */
+static bool
+matches_expect (void)
+{
+  size_t i;
+
+  for (i = 0; i < CHECK_SIZE; i++)
+    if (dst[i] != expect[i])
+      return false;
+  return true;
+}
+
+/* Checks memcpy(), memset(), and memcmp() on SIZE bytes at
+   offset S_OFS in the source and D_OFS in the destination. */
+static void
+check_copy_set_cmp (size_t size, size_t s_ofs, size_t d_ofs)
+{
+  size_t i;
+
+  /* memcpy(). */
+  random_bytes (dst, sizeof dst);
+  memcpy (expect, dst, sizeof dst);
+  for (i = 0; i < size; i++)
+    expect[d_ofs + i] = src[s_ofs + i];
+  if (memcpy (dst + d_ofs, src + s_ofs, size) != dst + d_ofs
+      || !matches_expect ())
+    fail ("memcpy of %zu bytes from offset %zu to offset %zu",
+          size, s_ofs, d_ofs);
+
+  /* memset(). */
+  for (i = 0; i < size; i++)
+    expect[d_ofs + i] = s_ofs * 0x55;
+  if (memset (dst + d_ofs, s_ofs * 0x55, size) != dst + d_ofs
+      || !matches_expect ())
+    fail ("memset of %zu bytes at offset %zu", size, d_ofs);
+
+  /* memcmp(), equal and then with a difference in the last
+     byte. */
+  memcpy (dst + d_ofs, src + s_ofs, size);
+  if (memcmp (dst + d_ofs, src + s_ofs, size) != 0)
+    fail ("memcmp of %zu equal bytes at offsets %zu and %zu",
+          size, d_ofs, s_ofs);
+  if (size > 0)
+    {
+      int cmp;
+
+      dst[d_ofs + size - 1] = src[s_ofs + size - 1] + 1;
+      cmp = memcmp (dst + d_ofs, src + s_ofs, size);
+      if ((cmp > 0) != (dst[d_ofs + size - 1] > src[s_ofs + size - 1])
+          || cmp == 0)
+        fail ("memcmp of %zu bytes at offsets %zu and %zu "
+              "differing in the last byte", size, d_ofs, s_ofs);
+    }
+}
+
+/* Checks memmove() of SIZE bytes within a single buffer, from
+   offset OFS to offset OFS + SHIFT, and from OFS + SHIFT to
+   OFS, so that the blocks overlap unless SHIFT >= SIZE. */
+static void
+check_overlap (size_t size, size_t ofs, size_t shift)
+{
+  size_t i;
+
+  /* Destination above the source, so it must copy downward. */
+  memcpy (dst, src, sizeof dst);
+  memcpy (expect, src, sizeof expect);
+  for (i = 0; i < size; i++)
+    expect[ofs + shift + i] = src[ofs + i];
+  if (memmove (dst + ofs + shift, dst + ofs, size) != dst + ofs + shift
+      || !matches_expect ())
+    fail ("memmove of %zu bytes from offset %zu up to offset %zu",
+          size, ofs, ofs + shift);
+
+  /* Destination below the source, so it must copy upward. */
+  memcpy (dst, src, sizeof dst);
+  memcpy (expect, src, sizeof expect);
+  for (i = 0; i < size; i++)
+    expect[ofs + i] = src[ofs + shift + i];
+  if (memmove (dst + ofs, dst + ofs + shift, size) != dst + ofs
+      || !matches_expect ())
+    fail ("memmove of %zu bytes from offset %zu down to offset %zu",
+          size, ofs + shift, ofs);
+}
+
+/* Prints the throughput of function WHICH (0 for memcpy(), 1
+   for memmove(), 2 for memset(), 3 for memcmp()), labeled NAME,
+   for each of several block sizes. */
+static void
+benchmark (const char *name, int which)
+{
+  static const size_t sizes[] = {16, 64, 512, 4096, 8192};
+  unsigned long long mbps[sizeof sizes / sizeof *sizes];
+  size_t i;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i];
+      unsigned long long bytes = 0;
+      int64_t start;
+
+      memcpy (bench_dst, bench_src, sizeof bench_dst);
+      start = timer_ticks ();
+      while (timer_elapsed (start) < BENCH_TICKS)
+        {
+          int j;
+
+          for (j = 0; j < 64; j++)
+            switch (which)
+              {
+              case 0:
+                memcpy (bench_dst, bench_src, size);
+                break;
+              case 1:
+                memmove (bench_dst + 4, bench_dst, size);
+                break;
+              case 2:
+                memset (bench_dst, j, size);
+                break;
+              case 3:
+                if (memcmp (bench_dst, bench_dst + 4, size) == 2)
+                  fail ("impossible");
+                break;
+              }
+          bytes += 64 * size;
+        }
+      mbps[i] = bytes * TIMER_FREQ / BENCH_TICKS / (1024 * 1024);
+    }
+  msg ("%s MB/s at 16, 64, 512, 4096, 8192 bytes: %llu %llu %llu %llu %llu.",
+       name, mbps[0], mbps[1], mbps[2], mbps[3], mbps[4]);
+}
@@ -0,0 +1,36 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the throughputs
+# varying from machine to machine and run to run:
+#
+# (string-ops) begin
+# (string-ops) memcpy, memset, memcmp: lengths 0 to 300 at all alignments ok.
+# (string-ops) memmove: lengths 0 to 300, overlapping by up to 8 bytes, ok.
+# (string-ops) memcpy MB/s at 16, 64, 512, 4096, 8192 bytes: 310 1020 2604 3011 3047.
+# (string-ops) memmove MB/s at 16, 64, 512, 4096, 8192 bytes: 254 712 1608 1790 1801.
+# (string-ops) memset MB/s at 16, 64, 512, 4096, 8192 bytes: 402 1303 3377 4012 4060.
+# (string-ops) memcmp MB/s at 16, 64, 512, 4096, 8192 bytes: 188 402 612 640 642.
+# (string-ops) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "memcpy, memset, or memcmp check did not finish.\n"
+  if !grep (/\) memcpy, memset, memcmp: lengths 0 to 300 at all alignments ok\.$/,
+	    @output);
+fail "memmove check did not finish.\n"
+  if !grep (/\) memmove: lengths 0 to 300, overlapping by up to 8 bytes, ok\.$/,
+	    @output);
+foreach my $func (qw (memcpy memmove memset memcmp)) {
+    fail "No throughput for $func.\n"
+      if !grep (/\) $func MB\/s at 16, 64, 512, 4096, 8192 bytes:( \d+){5}\.$/,
+		@output);
+}
+
+pass;
@@ -0,0 +1,81 @@
+/* Measures exec throughput in the style of examples/recursor.c.
+   The initial process repeatedly spawns a chain of CHAIN_DEPTH
+   nested processes, each of which execs the next one with a
+   multi-word command line and waits for it.  Every process
+   checks that its arguments arrived intact.  At the end, the
+   initial process reports the average number of CPU cycles per
+   exec, as measured by the timestamp counter. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Number of chains to spawn and the length of each one. */
+#define CHAIN_CNT 8
+#define CHAIN_DEPTH 16
+
+/* Arguments passed along at every level after the depth. */
+static const char *extra_args[] = {"alpha", "beta", "gamma", "delta"};
+#define EXTRA_CNT ((int) (sizeof extra_args / sizeof *extra_args))
+
+/* Execs the process at DEPTH in the chain and waits for it,
+   which should yield DEPTH as its exit code. */
+static void
+spawn (int depth) 
+{
+  char cmd_line[128];
+  pid_t pid;
+  int code;
+
+  snprintf (cmd_line, sizeof cmd_line, "exec-rate %d  %s %s  %s %s",
+            depth, extra_args[0], extra_args[1], extra_args[2],
+            extra_args[3]);
+  pid = exec (cmd_line);
+  if (pid == -1)
+    fail ("exec(\"%s\") failed", cmd_line);
+  code = wait (pid);
+  if (code != depth)
+    fail ("wait(exec(\"%s\")) returned %d", cmd_line, code);
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  uint64_t start, cycles;
+  int depth;
+  int i;
+
+  test_name = "exec-rate";
+
+  if (argc == 1) 
+    {
+      msg ("begin");
+      start = rdtsc ();
+      for (i = 0; i < CHAIN_CNT; i++)
+        spawn (CHAIN_DEPTH);
+      cycles = rdtsc () - start;
+      msg ("%d execs: %llu cycles per exec.", CHAIN_CNT * CHAIN_DEPTH,
+           cycles / (CHAIN_CNT * CHAIN_DEPTH));
+      msg ("end");
+      return 0;
+    }
+
+  /* A link in the chain: check our arguments, then spawn the
+     next link. */
+  if (argc != 2 + EXTRA_CNT)
+    fail ("argc is %d, expected %d", argc, 2 + EXTRA_CNT);
+  if (argv[argc] != NULL)
+    fail ("argv[argc] is not a null pointer");
+  for (i = 0; i < EXTRA_CNT; i++)
+    if (strcmp (argv[i + 2], extra_args[i]))
+      fail ("argv[%d] is \"%s\", expected \"%s\"",
+            i + 2, argv[i + 2], extra_args[i]);
+
+  depth = atoi (argv[1]);
+  if (depth > 1)
+    spawn (depth - 1);
+  return depth;
+}
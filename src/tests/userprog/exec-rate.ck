@@ -0,0 +1,33 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle count
+# varying from machine to machine and run to run, and with one
+# "exec-rate: exit(N)" line for every process in each chain:
+#
+# (exec-rate) begin
+# exec-rate: exit(1)
+# ...
+# exec-rate: exit(16)
+# (exec-rate) 128 execs: 1234567 cycles per exec.
+# (exec-rate) end
+# exec-rate: exit(0)
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($exits) = scalar (grep (/^exec-rate: exit\((\d+)\)$/
+			    && $1 >= 1 && $1 <= 16, @output));
+fail "Expected 128 child exits, found $exits.\n" if $exits != 128;
+fail "No per-exec cycle count found in output.\n"
+  if !grep (/^\(exec-rate\) 128 execs: \d+ cycles per exec\.$/, @output);
+fail "exec-rate did not exit cleanly.\n"
+  if !grep ($_ eq 'exec-rate: exit(0)', @output);
+
+pass;
@@ -0,0 +1,32 @@
+/* Measures system call overhead by timing 100,000 null
+   write() calls, each of which writes zero bytes to an open
+   file, and reports the average number of CPU cycles spent per
+   call as measured by the timestamp counter. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of write() calls to time. */
+#define CALL_CNT 100000
+
+void
+test_main (void) 
+{
+  uint64_t start, cycles;
+  char buf = 'x';
+  int handle;
+  int i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  start = rdtsc ();
+  for (i = 0; i < CALL_CNT; i++)
+    if (write (handle, &buf, 0) != 0)
+      fail ("write() of zero bytes returned nonzero");
+  cycles = rdtsc () - start;
+
+  msg ("%d null writes: %llu cycles per call.",
+       CALL_CNT, cycles / CALL_CNT);
+}
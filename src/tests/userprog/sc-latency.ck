@@ -0,0 +1,28 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle count
+# varying from machine to machine and run to run:
+#
+# (sc-latency) begin
+# (sc-latency) open "sample.txt"
+# (sc-latency) 100000 null writes: 412 cycles per call.
+# (sc-latency) end
+# sc-latency: exit(0)
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "No per-call cycle count found in output.\n"
+  if !grep (/^\(sc-latency\) 100000 null writes: \d+ cycles per call\.$/,
+	    @output);
+fail "sc-latency did not exit cleanly.\n"
+  if !grep ($_ eq 'sc-latency: exit(0)', @output);
+
+pass;
@@ -0,0 +1,42 @@
+/* Child process of page-exit.
+   Maps sample.txt at 64 addresses 4 MB apart and reads each
+   mapping, so that its address space spans 256 MB and needs a
+   page table per mapping, yet has only a few resident pages.
+   Just before exiting, writes the CPU's timestamp counter to
+   "exit-time", so that the parent can tell how long exiting
+   took. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+
+#define MAP_CNT 64
+#define MAP_STRIDE (4 * 1024 * 1024)
+#define MAP_BASE ((char *) 0x10000000)
+
+int
+main (void)
+{
+  uint64_t exited;
+  int handle, time_handle;
+  int i;
+
+  test_name = "child-exit";
+  quiet = true;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (i = 0; i < MAP_CNT; i++)
+    {
+      char *addr = MAP_BASE + i * MAP_STRIDE;
+      CHECK (mmap (handle, addr) != MAP_FAILED, "mmap \"sample.txt\"");
+      if (*addr != sample[0])
+        fail ("mapping %d has the wrong data", i);
+    }
+  CHECK ((time_handle = open ("exit-time")) > 1, "open \"exit-time\"");
+
+  exited = rdtsc ();
+  if (write (time_handle, &exited, sizeof exited) != sizeof exited)
+    fail ("write \"exit-time\"");
+  return 0;
+}
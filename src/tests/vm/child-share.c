@@ -0,0 +1,57 @@
+/* Child process of page-share.
+   Reads all of a 64 kB initialized array several times, then
+   writes its own ID into a few of its pages and checks that it
+   sees its own writes and the original data everywhere else,
+   whatever other instances of this program do at the same time. */
+
+#include <stdlib.h>
+#include "tests/lib.h"
+
+#define WORD_CNT (64 * 1024 / sizeof (unsigned))
+#define WORDS_PER_PAGE (4096 / sizeof (unsigned))
+#define INIT 0x5a5a5a5a
+
+/* Number of times to read the array, to keep the children
+   running long enough to overlap. */
+#define PASS_CNT 64
+
+/* Not static, so that the compiler cannot fold away the reads
+   of data[]. */
+unsigned data[WORD_CNT] = {[0 ... WORD_CNT - 1] = INIT};
+
+/* Returns the value that ID writes at word I, or INIT if ID
+   leaves word I alone. */
+static unsigned
+expected (int id, size_t i)
+{
+  return i / WORDS_PER_PAGE % 4 == (size_t) id % 4 ? (unsigned) id : INIT;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int id;
+  size_t i;
+  int pass;
+
+  test_name = "child-share";
+  if (argc != 2)
+    fail ("usage: child-share ID");
+  id = atoi (argv[1]);
+
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (i = 0; i < WORD_CNT; i++)
+      if (data[i] != INIT)
+        fail ("data[%zu] is %#x before writing", i, data[i]);
+
+  for (i = 0; i < WORD_CNT; i++)
+    if (expected (id, i) != INIT)
+      data[i] = id;
+
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (i = 0; i < WORD_CNT; i++)
+      if (data[i] != expected (id, i))
+        fail ("data[%zu] is %#x after writing", i, data[i]);
+
+  return id;
+}
@@ -0,0 +1,33 @@
+/* Child process of page-sparse.
+   Has a large initialized data segment and an even larger
+   uninitialized one, but touches only a few pages of each, so
+   that with demand paging only those pages need ever be read
+   or allocated. */
+
+#include "tests/lib.h"
+
+#define DATA_SIZE (256 * 1024)
+#define BSS_SIZE (4 * 1024 * 1024)
+
+/* Not static, so that the compiler cannot fold away the reads
+   of data[] that never changes. */
+char data[DATA_SIZE] = {[0] = 'a', [DATA_SIZE - 1] = 'z'};
+char bss[BSS_SIZE];
+
+int
+main (void)
+{
+  test_name = "child-sparse";
+
+  if (data[0] != 'a' || data[DATA_SIZE - 1] != 'z')
+    fail ("initialized data is wrong");
+  if (bss[0] != 0 || bss[BSS_SIZE - 1] != 0)
+    fail ("uninitialized data is not zero");
+
+  bss[0] = data[0];
+  bss[BSS_SIZE - 1] = data[DATA_SIZE - 1];
+  if (bss[0] != 'a' || bss[BSS_SIZE - 1] != 'z')
+    fail ("uninitialized data did not retain its value");
+
+  return 0x42;
+}
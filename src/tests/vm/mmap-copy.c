@@ -0,0 +1,89 @@
+/* Copies a 128 kB file twice, once as examples/cp does, with
+   read and write through a small buffer, and once as
+   examples/mcp does, by mapping both files and copying between
+   the mappings, and reports how many CPU cycles each copy
+   takes.  Then checks that both copies match the original. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (128 * 1024)
+#define CHUNK 4096
+
+#define SRC ((void *) 0x10000000)
+#define DST ((void *) 0x20000000)
+
+static char data[SIZE];
+static char buf[CHUNK];
+
+/* Copies "src" to "cp-dst" with read and write. */
+static void
+cp (void)
+{
+  int src, dst;
+  size_t ofs;
+
+  CHECK ((src = open ("src")) > 1, "open \"src\"");
+  CHECK (create ("cp-dst", SIZE), "create \"cp-dst\"");
+  CHECK ((dst = open ("cp-dst")) > 1, "open \"cp-dst\"");
+  for (ofs = 0; ofs < SIZE; ofs += CHUNK)
+    {
+      CHECK (read (src, buf, CHUNK) == CHUNK, "read \"src\"");
+      CHECK (write (dst, buf, CHUNK) == CHUNK, "write \"cp-dst\"");
+    }
+  close (dst);
+  close (src);
+}
+
+/* Copies "src" to "mcp-dst" with mmap and memcpy. */
+static void
+mcp (void)
+{
+  mapid_t src_map, dst_map;
+  int src, dst;
+
+  CHECK ((src = open ("src")) > 1, "open \"src\"");
+  CHECK (create ("mcp-dst", SIZE), "create \"mcp-dst\"");
+  CHECK ((dst = open ("mcp-dst")) > 1, "open \"mcp-dst\"");
+  CHECK ((src_map = mmap (src, SRC)) != MAP_FAILED, "mmap \"src\"");
+  CHECK ((dst_map = mmap (dst, DST)) != MAP_FAILED, "mmap \"mcp-dst\"");
+  memcpy (DST, SRC, SIZE);
+  munmap (dst_map);
+  munmap (src_map);
+  close (dst);
+  close (src);
+}
+
+void
+test_main (void)
+{
+  uint64_t start, cp_cycles, mcp_cycles;
+  int handle;
+  size_t i;
+
+  quiet = true;
+  for (i = 0; i < SIZE; i++)
+    data[i] = i * 257 / 7;
+  CHECK (create ("src", SIZE), "create \"src\"");
+  CHECK ((handle = open ("src")) > 1, "open \"src\"");
+  CHECK (write (handle, data, SIZE) == SIZE, "write \"src\"");
+  close (handle);
+
+  start = rdtsc ();
+  cp ();
+  cp_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  mcp ();
+  mcp_cycles = rdtsc () - start;
+
+  check_file ("cp-dst", data, SIZE);
+  check_file ("mcp-dst", data, SIZE);
+  quiet = false;
+
+  msg ("cp copied %d bytes in %llu cycles", SIZE, cp_cycles);
+  msg ("mcp copied %d bytes in %llu cycles", SIZE, mcp_cycles);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle counts
+# varying from machine to machine and run to run:
+#
+# (mmap-copy) begin
+# (mmap-copy) cp copied 131072 bytes in 12345678 cycles
+# (mmap-copy) mcp copied 131072 bytes in 12345678 cycles
+# (mmap-copy) end
+# mmap-copy: exit(0)
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+foreach my $how ('cp', 'mcp') {
+    fail "No cycle count found for $how in output.\n"
+      if !grep (/^\(mmap-copy\) $how copied 131072 bytes in \d+ cycles$/,
+		@output);
+}
+fail "Missing \"end\" message.\n" if !grep ($_ eq '(mmap-copy) end', @output);
+
+pass;
@@ -0,0 +1,44 @@
+/* Runs child-exit, whose address space spans 256 MB of sparse
+   mappings, several times in turn, and reports the average
+   number of CPU cycles from the timestamp that the child writes
+   to "exit-time" just before returning from main() to the
+   parent's return from wait(), which is mostly the time it takes
+   to tear down the child's address space. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of times to run the child. */
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  uint64_t cycles = 0;
+  int i;
+
+  quiet = true;
+  CHECK (create ("exit-time", sizeof (uint64_t)), "create \"exit-time\"");
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      uint64_t exited, waited;
+      pid_t child;
+      int handle;
+
+      CHECK ((child = exec ("child-exit")) != -1, "exec \"child-exit\"");
+      CHECK (wait (child) == 0, "wait for child-exit");
+      waited = rdtsc ();
+
+      CHECK ((handle = open ("exit-time")) > 1, "open \"exit-time\"");
+      CHECK (read (handle, &exited, sizeof exited) == sizeof exited,
+             "read \"exit-time\"");
+      close (handle);
+      cycles += waited - exited;
+    }
+  quiet = false;
+
+  msg ("%d runs of child-exit: %llu cycles per exit",
+       CHILD_CNT, cycles / CHILD_CNT);
+}
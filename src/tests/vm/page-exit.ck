@@ -0,0 +1,30 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle count
+# varying from machine to machine and run to run:
+#
+# (page-exit) begin
+# child-exit: exit(0)
+# ...
+# child-exit: exit(0)
+# (page-exit) 8 runs of child-exit: 1234567 cycles per exit
+# (page-exit) end
+# page-exit: exit(0)
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($exits) = scalar (grep ($_ eq 'child-exit: exit(0)', @output));
+fail "Expected 8 child exits, found $exits.\n" if $exits != 8;
+fail "No per-exit cycle count found in output.\n"
+  if !grep (/^\(page-exit\) 8 runs of child-exit: \d+ cycles per exit$/,
+	    @output);
+fail "Missing \"end\" message.\n" if !grep ($_ eq '(page-exit) end', @output);
+
+pass;
@@ -0,0 +1,49 @@
+/* Multiplies two 128x128 matrices of ints, as examples/matmult.c
+   does, with the kernel limited to fewer user frames than the
+   three matrices occupy, and reports how many CPU cycles the
+   whole computation takes.  The matrices can only fit by
+   swapping, and the time shows how well swap copes. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DIM 128
+
+static int A[DIM][DIM];
+static int B[DIM][DIM];
+static int C[DIM][DIM];
+
+void
+test_main (void)
+{
+  uint64_t start, cycles;
+  int i, j, k;
+
+  start = rdtsc ();
+
+  /* Initialize the matrices. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      {
+        A[i][j] = i;
+        B[i][j] = j;
+        C[i][j] = 0;
+      }
+
+  /* Multiply matrices. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      for (k = 0; k < DIM; k++)
+        C[i][j] += A[i][k] * B[k][j];
+
+  cycles = rdtsc () - start;
+
+  /* Check the result. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      if (C[i][j] != i * j * DIM)
+        fail ("C[%d][%d] is %d instead of %d", i, j, C[i][j], i * j * DIM);
+
+  msg ("multiplied %dx%d matrices in %llu cycles", DIM, DIM, cycles);
+}
@@ -0,0 +1,40 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle count
+# varying from machine to machine and run to run, followed at
+# shutdown by the kernel's statistics:
+#
+# (page-matmult) begin
+# (page-matmult) multiplied 128x128 matrices in 123456789 cycles
+# (page-matmult) end
+# page-matmult: exit(0)
+# ...
+# Frames: 32 total, 32 peak in use, 160 evictions, 0 shared faults
+# Swap: 96 pages written in 14 requests, 90 pages read
+#
+# The matrices take 48 pages but the kernel has only 32 user
+# frames, so pages must go to swap, and dirty pages should go
+# out several to a request.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "No cycle count found in output.\n"
+  if !grep (/^\(page-matmult\) multiplied 128x128 matrices in \d+ cycles$/,
+	    @output);
+fail "Missing \"end\" message.\n" if !grep ($_ eq '(page-matmult) end', @output);
+
+my ($written, $requests) =
+  map (/^Swap: (\d+) pages written in (\d+) requests/, @output);
+fail "No swap statistics found in output.\n" if !defined $requests;
+fail "No pages were written to swap.\n" if $written == 0;
+fail "$written pages took $requests requests to write to swap.\n"
+  if $requests >= $written;
+
+pass;
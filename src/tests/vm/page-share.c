@@ -0,0 +1,38 @@
+/* Runs 8 child-share processes at once and reports the average
+   number of CPU cycles it takes to exec them all and wait for
+   them.  Each child reads a large initialized array and then
+   modifies a few pages of it, so the children should share the
+   pages of their executable that none of them writes, and each
+   gets a copy of only the pages it modifies. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  uint64_t start, cycles;
+  int i;
+
+  quiet = true;
+  start = rdtsc ();
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      char cmd[32];
+      snprintf (cmd, sizeof cmd, "child-share %d", i);
+      CHECK ((children[i] = exec (cmd)) != -1, "exec \"%s\"", cmd);
+    }
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == i, "wait for child %d", i);
+  cycles = rdtsc () - start;
+  quiet = false;
+
+  msg ("%d concurrent runs of child-share: %llu cycles per exec",
+       CHILD_CNT, cycles / CHILD_CNT);
+}
@@ -0,0 +1,43 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle count
+# varying from machine to machine and run to run, followed at
+# shutdown by the kernel's statistics:
+#
+# (page-share) begin
+# child-share: exit(0)
+# ...
+# child-share: exit(7)
+# (page-share) 8 concurrent runs of child-share: 1234567 cycles per exec
+# (page-share) end
+# page-share: exit(0)
+# ...
+# Frames: 383 total, 52 peak in use, 0 evictions, 120 shared faults
+#
+# Each child-share touches about 20 pages, 16 of them its
+# initialized array, but writes only 4 of those, so with
+# sharing the children need far fewer than 160 frames in all.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+foreach my $id (0...7) {
+    fail "child-share $id did not exit properly.\n"
+      if !grep ($_ eq "child-share: exit($id)", @output);
+}
+fail "No per-exec cycle count found in output.\n"
+  if !grep (/^\(page-share\) 8 concurrent runs of child-share: \d+ cycles per exec$/,
+	    @output);
+
+my ($total, $peak) = map (/^Frames: (\d+) total, (\d+) peak in use/,
+			  @output);
+fail "No frame statistics found in output.\n" if !defined $peak;
+fail "$peak of $total frames were in use at once.\n" if $peak > 120;
+
+pass;
@@ -0,0 +1,31 @@
+/* Runs a child process whose data and BSS segments together
+   are larger than all of user memory, but which touches only a
+   handful of their pages, and reports the average number of
+   CPU cycles it takes to exec and wait for it.  With demand
+   paging, the child can load at all, and quickly, because only
+   the pages it touches are read or allocated. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of times to run the child. */
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  uint64_t start, cycles;
+  int i;
+
+  quiet = true;
+  start = rdtsc ();
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (exec ("child-sparse")) == 0x42, "wait for child-sparse");
+  cycles = rdtsc () - start;
+  quiet = false;
+
+  msg ("%d runs of child-sparse: %llu cycles per exec",
+       CHILD_CNT, cycles / CHILD_CNT);
+}
@@ -0,0 +1,40 @@
+# -*- perl -*-
+
+# The expected output looks like this, with the cycle count
+# varying from machine to machine and run to run, followed at
+# shutdown by the kernel's statistics:
+#
+# (page-sparse) begin
+# child-sparse: exit(66)
+# ...
+# child-sparse: exit(66)
+# (page-sparse) 8 runs of child-sparse: 1234567 cycles per exec
+# (page-sparse) end
+# page-sparse: exit(0)
+# ...
+# Frames: 383 total, 17 peak in use, 0 evictions
+#
+# child-sparse's segments span more than 1,000 pages, but only
+# the few pages it touches should ever occupy a frame.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($exits) = scalar (grep ($_ eq 'child-sparse: exit(66)', @output));
+fail "Expected 8 child exits, found $exits.\n" if $exits != 8;
+fail "No per-exec cycle count found in output.\n"
+  if !grep (/^\(page-sparse\) 8 runs of child-sparse: \d+ cycles per exec$/,
+	    @output);
+
+my ($total, $peak) = map (/^Frames: (\d+) total, (\d+) peak in use/,
+			  @output);
+fail "No frame statistics found in output.\n" if !defined $peak;
+fail "$peak of $total frames were in use at once.\n" if $peak > 32;
+
+pass;
@@ -0,0 +1,15 @@
+/* Allocates a 2 MB object on the stack, with the kernel limiting
+   stacks to 1 MB, and touches its bottom byte.  The process must
+   be terminated with -1 exit code. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  volatile char stk_obj[2 * 1024 * 1024];
+
+  stk_obj[0] = 1;
+  fail ("grew the stack past its limit to %p", stk_obj);
+}
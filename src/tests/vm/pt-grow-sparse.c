@@ -0,0 +1,25 @@
+/* Allocates a 4 MB object on the stack and touches one byte in
+   every 64 kB of it.  This must succeed, and since stack pages
+   are zero-filled only when touched, it must not need anywhere
+   near one frame per page of the object. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)
+#define STRIDE (64 * 1024)
+
+void
+test_main (void)
+{
+  volatile char stk_obj[SIZE];
+  int i;
+
+  for (i = SIZE - 1; i >= 0; i -= STRIDE)
+    stk_obj[i] = i / STRIDE;
+  for (i = SIZE - 1; i >= 0; i -= STRIDE)
+    if (stk_obj[i] != i / STRIDE)
+      fail ("byte %d of stack object is %d, not %d",
+            i, stk_obj[i], i / STRIDE);
+  msg ("touched %d pages of a %d-byte stack object", SIZE / STRIDE, SIZE);
+}
@@ -0,0 +1,35 @@
+# -*- perl -*-
+
+# The expected output looks like this, followed at shutdown by
+# the kernel's statistics:
+#
+# (pt-grow-sparse) begin
+# (pt-grow-sparse) touched 64 pages of a 4194304-byte stack object
+# (pt-grow-sparse) end
+# pt-grow-sparse: exit(0)
+# ...
+# Frames: 383 total, 90 peak in use, 0 evictions, 0 shared faults
+#
+# The stack object spans 1024 pages, but only 64 of them are
+# touched, so far fewer frames than that should ever be in use.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "Missing \"touched\" message.\n"
+  if !grep ($_ eq '(pt-grow-sparse) touched 64 pages of a 4194304-byte stack object', @output);
+fail "Missing \"end\" message.\n"
+  if !grep ($_ eq '(pt-grow-sparse) end', @output);
+
+my ($total, $peak) = map (/^Frames: (\d+) total, (\d+) peak in use/,
+			  @output);
+fail "No frame statistics found in output.\n" if !defined $peak;
+fail "$peak of $total frames were in use at once.\n" if $peak > 200;
+
+pass;
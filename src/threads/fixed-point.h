@@ -0,0 +1,87 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, as used by the MLFQS.
+
+   A fixed-point number X is stored as the int X * FP_ONE: 17
+   bits before the binary point, 14 after it, and a sign bit.
+   Multiplication and division go through 64 bits so that the
+   intermediate product or dividend cannot overflow. */
+typedef int fixed_point_t;
+
+#define FP_SHIFT 14                     /* Number of fraction bits. */
+#define FP_ONE (1 << FP_SHIFT)          /* 1.0 in fixed point. */
+
+/* Converts integer N to fixed point. */
+static inline fixed_point_t
+fp_from_int (int n) 
+{
+  return n * FP_ONE;
+}
+
+/* Converts X to an integer, rounding toward zero. */
+static inline int
+fp_trunc (fixed_point_t x) 
+{
+  return x / FP_ONE;
+}
+
+/* Converts X to an integer, rounding to nearest. */
+static inline int
+fp_round (fixed_point_t x) 
+{
+  return x >= 0 ? (x + FP_ONE / 2) / FP_ONE : (x - FP_ONE / 2) / FP_ONE;
+}
+
+/* Returns X + Y. */
+static inline fixed_point_t
+fp_add (fixed_point_t x, fixed_point_t y) 
+{
+  return x + y;
+}
+
+/* Returns X - Y. */
+static inline fixed_point_t
+fp_sub (fixed_point_t x, fixed_point_t y) 
+{
+  return x - y;
+}
+
+/* Returns X + N, for integer N. */
+static inline fixed_point_t
+fp_add_int (fixed_point_t x, int n) 
+{
+  return x + n * FP_ONE;
+}
+
+/* Returns X * Y. */
+static inline fixed_point_t
+fp_mul (fixed_point_t x, fixed_point_t y) 
+{
+  return ((int64_t) x) * y / FP_ONE;
+}
+
+/* Returns X / Y. */
+static inline fixed_point_t
+fp_div (fixed_point_t x, fixed_point_t y) 
+{
+  return ((int64_t) x) * FP_ONE / y;
+}
+
+/* Returns X * N, for integer N. */
+static inline fixed_point_t
+fp_mul_int (fixed_point_t x, int n) 
+{
+  return x * n;
+}
+
+/* Returns X / N, for integer N. */
+static inline fixed_point_t
+fp_div_int (fixed_point_t x, int n) 
+{
+  return x / n;
+}
+
+#endif /* threads/fixed-point.h */
@@ -37,6 +37,11 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -114,6 +119,9 @@ main (void)
   exception_init ();
   syscall_init ();
 #endif
+#ifdef VM
+  frame_init ();
+#endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
@@ -127,6 +135,10 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  swap_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -259,6 +271,10 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-stack"))
+        page_stack_max = (size_t) atoi (value) * 1024 * 1024;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -381,6 +397,9 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -stack=MB          Limit user stacks to MB megabytes.\n"
 #endif
           );
   shutdown_power_off ();
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -24,9 +25,19 @@
    list.  Then we return one of the new blocks.
 
    When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   If the arena that the block was in now has no in-use blocks,
+   and the descriptor already has EMPTY_ARENA_MAX other such
+   arenas, we remove all of the arena's blocks from the free list
+   and give the arena back to the page allocator.  Keeping a few
+   empty arenas around avoids getting and freeing a page over and
+   over when a block is repeatedly allocated and freed.
+
+   In front of each descriptor's free list sits a "magazine", a
+   small stack of recently freed blocks.  malloc() and free()
+   use the magazine with interrupts disabled instead of taking
+   the descriptor's lock, and go to the free list only to refill
+   an empty magazine or drain a full one, moving several blocks
+   at a time.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -34,13 +45,33 @@
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Number of blocks that a magazine holds. */
+#define MAG_SIZE 16
+
+/* Number of blocks moved between a magazine and its
+   descriptor's free list at a time. */
+#define MAG_BATCH (MAG_SIZE / 2)
+
+/* Number of empty arenas that a descriptor keeps. */
+#define EMPTY_ARENA_MAX 2
+
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+
+    /* Protected by LOCK. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+    size_t empty_cnt;           /* Number of arenas with no used blocks. */
+    long long arena_get_cnt;    /* Arenas obtained from palloc. */
+    long long arena_put_cnt;    /* Arenas returned to palloc. */
+
+    /* Magazine.  Accessed only with interrupts off.  Blocks in
+       the magazine count as in use in their arenas. */
+    struct block *mag[MAG_SIZE];  /* Free blocks. */
+    size_t mag_cnt;             /* Number of blocks in MAG. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -64,8 +95,15 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics, updated with interrupts off. */
+static long long alloc_cnt;     /* Blocks allocated by descriptors. */
+static long long free_cnt;      /* Blocks freed to descriptors. */
+static long long mag_alloc_cnt; /* Allocations served by magazines. */
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void *refill_alloc (struct desc *);
+static void drain_free (struct desc *, struct block *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -81,6 +119,9 @@ malloc_init (void)
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
       list_init (&d->free_list);
       lock_init (&d->lock);
+      d->empty_cnt = 0;
+      d->arena_get_cnt = d->arena_put_cnt = 0;
+      d->mag_cnt = 0;
     }
 }
 
@@ -90,8 +131,8 @@ void *
 malloc (size_t size) 
 {
   struct desc *d;
-  struct block *b;
   struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -119,20 +160,40 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
+  /* Take a block from the magazine, if it has one. */
+  old_level = intr_disable ();
+  alloc_cnt++;
+  if (d->mag_cnt > 0) 
+    {
+      struct block *b = d->mag[--d->mag_cnt];
+      mag_alloc_cnt++;
+      intr_set_level (old_level);
+      return b;
+    }
+  intr_set_level (old_level);
+
+  return refill_alloc (d);
+}
+
+/* Removes and returns a block from D's free list, creating a new
+   arena if the free list is empty and CREATE is true.  Returns a
+   null pointer if there is no block.  D's lock must be held. */
+static struct block *
+take_block (struct desc *d, bool create) 
+{
+  struct block *b;
+  struct arena *a;
 
-  /* If the free list is empty, create a new arena. */
   if (list_empty (&d->free_list))
     {
       size_t i;
 
       /* Allocate a page. */
+      if (!create)
+        return NULL;
       a = palloc_get_page (0);
       if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
+        return NULL; 
 
       /* Initialize arena and add its blocks to the free list. */
       a->magic = ARENA_MAGIC;
@@ -143,16 +204,109 @@ malloc (size_t size)
           struct block *b = arena_to_block (a, i);
           list_push_back (&d->free_list, &b->free_elem);
         }
+      d->empty_cnt++;
+      d->arena_get_cnt++;
     }
 
-  /* Get a block from free list and return it. */
+  /* Get a block from free list. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  if (a->free_cnt-- == d->blocks_per_arena)
+    d->empty_cnt--;
   return b;
 }
 
+/* Adds block B to D's free list.  If B's arena is then unused
+   and D has enough empty arenas already, frees the arena.  D's
+   lock must be held. */
+static void
+put_block (struct desc *d, struct block *b) 
+{
+  struct arena *a = block_to_arena (b);
+
+  list_push_front (&d->free_list, &b->free_elem);
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      if (d->empty_cnt >= EMPTY_ARENA_MAX) 
+        {
+          size_t i;
+
+          for (i = 0; i < d->blocks_per_arena; i++) 
+            {
+              struct block *b = arena_to_block (a, i);
+              list_remove (&b->free_elem);
+            }
+          palloc_free_page (a);
+          d->arena_put_cnt++;
+        }
+      else
+        d->empty_cnt++;
+    }
+}
+
+/* Allocates a block from D's free list, for when D's magazine is
+   empty, and puts up to MAG_BATCH more that are already free in
+   the magazine for later calls.  Returns the block, or a null
+   pointer if memory is not available. */
+static void *
+refill_alloc (struct desc *d) 
+{
+  struct block *batch[MAG_BATCH + 1];
+  size_t cnt, i;
+  enum intr_level old_level;
+
+  lock_acquire (&d->lock);
+  batch[0] = take_block (d, true);
+  if (batch[0] == NULL) 
+    {
+      lock_release (&d->lock);
+      return NULL;
+    }
+  for (cnt = 1; cnt < MAG_BATCH + 1; cnt++)
+    if ((batch[cnt] = take_block (d, false)) == NULL)
+      break;
+  lock_release (&d->lock);
+
+  /* Another thread may have filled the magazine meanwhile, so
+     return any blocks that do not fit. */
+  old_level = intr_disable ();
+  for (i = 1; i < cnt && d->mag_cnt < MAG_SIZE; i++)
+    d->mag[d->mag_cnt++] = batch[i];
+  intr_set_level (old_level);
+  if (i < cnt) 
+    {
+      lock_acquire (&d->lock);
+      for (; i < cnt; i++)
+        put_block (d, batch[i]);
+      lock_release (&d->lock);
+    }
+
+  return batch[0];
+}
+
+/* Frees block B to D's free list, for when D's magazine is full,
+   along with MAG_BATCH blocks from the magazine to make room for
+   later calls. */
+static void
+drain_free (struct desc *d, struct block *b) 
+{
+  struct block *batch[MAG_BATCH + 1];
+  size_t cnt, i;
+  enum intr_level old_level;
+
+  batch[0] = b;
+  old_level = intr_disable ();
+  for (cnt = 1; cnt < MAG_BATCH + 1 && d->mag_cnt > 0; cnt++)
+    batch[cnt] = d->mag[--d->mag_cnt];
+  intr_set_level (old_level);
+
+  lock_acquire (&d->lock);
+  for (i = 0; i < cnt; i++)
+    put_block (d, batch[i]);
+  lock_release (&d->lock);
+}
+
 /* Allocates and return A times B bytes initialized to zeroes.
    Returns a null pointer if memory is not available. */
 void *
@@ -227,32 +381,25 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          enum intr_level old_level;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Put the block in the magazine, if there is room. */
+          old_level = intr_disable ();
+          free_cnt++;
+          if (d->mag_cnt < MAG_SIZE) 
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              d->mag[d->mag_cnt++] = b;
+              intr_set_level (old_level);
+              return;
             }
+          intr_set_level (old_level);
 
-          lock_release (&d->lock);
+          drain_free (d, b);
         }
       else
         {
@@ -263,6 +410,23 @@ free (void *p)
     }
 }
 
+/* Prints malloc() statistics. */
+void
+malloc_print_stats (void) 
+{
+  long long arena_get_cnt = 0, arena_put_cnt = 0;
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++) 
+    {
+      arena_get_cnt += d->arena_get_cnt;
+      arena_put_cnt += d->arena_put_cnt;
+    }
+  printf ("Malloc: %lld allocs (%lld from magazines), %lld frees, "
+          "%lld arenas created, %lld freed\n",
+          alloc_cnt, mag_alloc_cnt, free_cnt, arena_get_cnt, arena_put_cnt);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
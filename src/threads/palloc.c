@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,14 +24,52 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages are
+   kept in blocks of 2**ORDER pages, for ORDER from 0 to
+   MAX_ORDER, each aligned (relative to the pool's base) on a
+   multiple of its size and linked into the free list for its
+   order through a list_elem in its first page.  A request for
+   PAGE_CNT pages takes the smallest free block that can hold it,
+   splitting larger blocks in half as needed, and gives back any
+   pages at the end of the block that it does not need.  Freeing
+   pages merges each freed block with its "buddy", the other
+   half of the block twice its size, for as long as the buddy is
+   also free.  Both take time proportional to MAX_ORDER, not to
+   the size of the pool.
+
+   Because a request is carved from a single aligned block, a
+   request for PAGE_CNT pages needs a free block of the next power
+   of 2 at least PAGE_CNT pages in size.  A request for more than
+   half of a pool may thus fail even when enough contiguous pages
+   are free, which a simple scan for a run of free pages would
+   have found.
+
+   The free lists are protected by turning interrupts off rather
+   than by a lock, because thread_schedule_tail() frees a dying
+   thread's page in the middle of a context switch, where it may
+   not block.  Each operation keeps interrupts off only for
+   MAX_ORDER steps or so. */
+
+/* Largest block order.  Blocks of 2**MAX_ORDER pages are 64 MB,
+   the most RAM that Pintos uses, so every pool fits in one. */
+#define MAX_ORDER 14
+
+/* Value in a pool's ORDERS array for a page that does not start
+   a free block. */
+#define NOT_FREE 0xff
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    uint8_t *orders;                    /* Order of the free block that
+                                           starts at each page, or
+                                           NOT_FREE. */
+    struct list free_lists[MAX_ORDER + 1];  /* Free blocks by order. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +78,9 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static struct pool *pool_for_page (void *page);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,15 +113,18 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  page_idx = alloc_pages (pool, page_cnt);
+  if (page_idx != BITMAP_ERROR)
+    bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -118,27 +163,25 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED ();
-
+  pool = pool_for_page (pages);
   page_idx = pg_no (pages) - pg_no (pool->base);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_pages (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +191,162 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Frees the PAGE_CNT separate pages whose addresses are in
+   PAGES, which may come from either pool, turning interrupts off
+   once for all of them instead of once per page. */
+void
+palloc_free_pages (void **pages, size_t page_cnt)
+{
+  enum intr_level old_level;
+  size_t i;
+
+#ifndef NDEBUG
+  for (i = 0; i < page_cnt; i++)
+    memset (pages[i], 0xcc, PGSIZE);
+#endif
+
+  old_level = intr_disable ();
+  for (i = 0; i < page_cnt; i++)
+    {
+      void *page = pages[i];
+      struct pool *pool = pool_for_page (page);
+      size_t page_idx = pg_no (page) - pg_no (pool->base);
+
+      ASSERT (pg_ofs (page) == 0);
+      ASSERT (bitmap_test (pool->used_map, page_idx));
+      bitmap_reset (pool->used_map, page_idx);
+      free_pages (pool, page_idx, 1);
+    }
+  intr_set_level (old_level);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map and orders array at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t meta_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  size_t order;
+  if (meta_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= meta_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->orders = (uint8_t *) base + bm_size;
+  p->base = base + meta_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  memset (p->orders, NOT_FREE, page_cnt);
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+
+  /* Every page starts out free. */
+  free_pages (p, 0, page_cnt);
+}
+
+/* Returns the first page of the block of pages at PAGE_IDX in
+   POOL. */
+static struct list_elem *
+block_elem (struct pool *pool, size_t page_idx) 
+{
+  return (struct list_elem *) (pool->base + page_idx * PGSIZE);
+}
+
+/* Returns the smallest order of a block that holds PAGE_CNT
+   pages. */
+static size_t
+order_for (size_t page_cnt) 
+{
+  size_t order = 0;
+
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX in POOL to
+   the free lists, first merging it with its buddy, and the
+   resulting block with its buddy, and so on, as far as possible.
+   Interrupts must be off. */
+static void
+free_block (struct pool *pool, size_t page_idx, size_t order) 
+{
+  while (order < MAX_ORDER) 
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+      if (buddy + ((size_t) 1 << order) > pool->page_cnt
+          || pool->orders[buddy] != order)
+        break;
+
+      /* Merge with buddy. */
+      list_remove (block_elem (pool, buddy));
+      pool->orders[buddy] = NOT_FREE;
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+
+  pool->orders[page_idx] = order;
+  list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, by dividing them
+   into the largest aligned blocks that they contain and freeing
+   each block.  Interrupts must be off, except during
+   initialization. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  while (page_cnt > 0) 
+    {
+      size_t order = 0;
+
+      while (order < MAX_ORDER
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if there is no free block
+   large enough.  Interrupts must be off. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt) 
+{
+  size_t want = order_for (page_cnt);
+  size_t order, page_idx;
+
+  /* Find the smallest free block that is large enough. */
+  for (order = want; order <= MAX_ORDER; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order > MAX_ORDER)
+    return BITMAP_ERROR;
+  page_idx = ((uint8_t *) list_pop_front (&pool->free_lists[order])
+              - pool->base) / PGSIZE;
+  pool->orders[page_idx] = NOT_FREE;
+
+  /* Split it down to the order we want, freeing the upper
+     halves. */
+  while (order > want) 
+    {
+      order--;
+      free_block (pool, page_idx + ((size_t) 1 << order), order);
+    }
+
+  /* Give back the pages past the end of the request. */
+  free_pages (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +360,15 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the pool that PAGE was allocated from. */
+static struct pool *
+pool_for_page (void *page)
+{
+  if (page_from_pool (&kernel_pool, page))
+    return &kernel_pool;
+  else if (page_from_pool (&user_pool, page))
+    return &user_pool;
+  else
+    NOT_REACHED ();
+}
@@ -0,0 +1,279 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Object caches for fixed-size kernel objects.
+
+   malloc() rounds every request up to a power of 2, which
+   wastes up to half of each block for objects of awkward sizes
+   such as struct inode.  An object cache instead carves pages,
+   called "slabs", into objects of exactly one size.  Each slab
+   starts with a header that tracks its free objects, and
+   belongs to one of its cache's three lists: full, partial, or
+   empty.  Allocation takes an object from a partial slab, or
+   failing that an empty one, or failing that a new slab.
+
+   A cache may have a constructor, which is run on each object
+   once, when its slab is created, rather than on every
+   allocation.  Users must free objects in their constructed
+   state.  To keep objects intact while they are free, a slab
+   links its free objects through an array of indexes in its
+   header instead of through the objects themselves.
+
+   Like malloc(), a cache keeps a limited number of empty slabs,
+   SLAB_EMPTY_MAX, to absorb allocation churn, and returns the
+   rest to the page allocator. */
+
+/* Number of empty slabs that a cache keeps. */
+#define SLAB_EMPTY_MAX 1
+
+/* Marks the end of a slab's free list. */
+#define FREE_END ((uint16_t) -1)
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* An object cache. */
+struct kmem_cache 
+  {
+    struct list_elem elem;      /* Element in all_caches. */
+    const char *name;           /* Name, for statistics. */
+    size_t size;                /* Object size, rounded up to ALIGN. */
+    size_t align;               /* Object alignment. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    size_t obj_cnt;             /* Objects per slab. */
+    size_t obj_ofs;             /* Offset of first object in slab. */
+
+    /* Protected by LOCK. */
+    struct lock lock;
+    struct list full;           /* Slabs with no free objects. */
+    struct list partial;        /* Slabs with some free objects. */
+    struct list empty;          /* Slabs with no used objects. */
+    size_t empty_cnt;           /* Number of slabs in EMPTY. */
+
+    /* Statistics, also protected by LOCK. */
+    long long alloc_cnt;        /* Objects allocated. */
+    long long free_cnt;         /* Objects freed. */
+    size_t slab_cnt;            /* Slabs now held. */
+    size_t in_use;              /* Objects now allocated. */
+    size_t peak_in_use;         /* Most objects allocated at once. */
+  };
+
+/* Slab header, at the start of each slab's page. */
+struct slab 
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of CACHE's lists. */
+    size_t in_use;              /* Number of allocated objects. */
+    uint16_t free;              /* Index of first free object. */
+    uint16_t next[];            /* Index of next free object, per object. */
+  };
+
+/* All caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+/* Returns a new cache named NAME for objects of SIZE bytes,
+   aligned on ALIGN-byte boundaries, where ALIGN is a power of 2
+   or 0 for the default of pointer alignment.  If CTOR is
+   non-null, it is called on each object when its slab is
+   created.  NAME must remain valid as long as the cache does.
+   Objects must be small enough for several to fit in a page.
+   Panics if memory is not available, since caches are created
+   at initialization time. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+                   kmem_ctor_func *ctor) 
+{
+  struct kmem_cache *c;
+
+  if (align == 0)
+    align = sizeof (void *);
+  ASSERT ((align & (align - 1)) == 0);
+  ASSERT (size > 0 && size <= PGSIZE / 4);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    PANIC ("out of memory creating cache %s", name);
+  c->name = name;
+  c->size = ROUND_UP (size, align);
+  c->align = align;
+  c->ctor = ctor;
+
+  /* Fit as many objects as possible after the header and its
+     array of free list links. */
+  c->obj_cnt = (PGSIZE - sizeof (struct slab)) / c->size;
+  for (;;) 
+    {
+      c->obj_ofs = ROUND_UP (sizeof (struct slab)
+                             + c->obj_cnt * sizeof (uint16_t), align);
+      if (c->obj_ofs + c->obj_cnt * c->size <= PGSIZE)
+        break;
+      c->obj_cnt--;
+    }
+
+  lock_init (&c->lock);
+  list_init (&c->full);
+  list_init (&c->partial);
+  list_init (&c->empty);
+  c->empty_cnt = 0;
+  c->alloc_cnt = c->free_cnt = 0;
+  c->slab_cnt = c->in_use = c->peak_in_use = 0;
+  list_push_back (&all_caches, &c->elem);
+  return c;
+}
+
+/* Returns the object with index IDX in slab S. */
+static void *
+slab_object (struct slab *s, size_t idx) 
+{
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->size;
+}
+
+/* Creates and returns a new, empty slab for cache C, or a null
+   pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c) 
+{
+  struct slab *s = palloc_get_page (0);
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->free = 0;
+  for (i = 0; i < c->obj_cnt; i++) 
+    {
+      s->next[i] = i + 1 < c->obj_cnt ? i + 1 : FREE_END;
+      if (c->ctor != NULL)
+        c->ctor (slab_object (s, i));
+    }
+  c->slab_cnt++;
+  return s;
+}
+
+/* Allocates and returns an object from cache C, or a null
+   pointer if memory is not available.  If C has a constructor,
+   the object is in its constructed state, or the state in which
+   it was last freed; otherwise, its contents are unspecified. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) 
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+
+  /* Find a slab with a free object. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty)) 
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else 
+    {
+      s = slab_create (c);
+      if (s == NULL) 
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take the object. */
+  ASSERT (s->free != FREE_END);
+  obj = slab_object (s, s->free);
+  s->free = s->next[s->free];
+  if (++s->in_use == c->obj_cnt) 
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+
+  c->alloc_cnt++;
+  if (++c->in_use > c->peak_in_use)
+    c->peak_in_use = c->in_use;
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Frees OBJ, which must have been allocated from cache C.  A
+   null OBJ is ignored. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s;
+  size_t idx;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->size == 0);
+  idx = (pg_ofs (obj) - c->obj_ofs) / c->size;
+
+  lock_acquire (&c->lock);
+
+  /* Put the object back on the slab's free list. */
+  s->next[idx] = s->free;
+  s->free = idx;
+  if (s->in_use-- == c->obj_cnt) 
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Keep the slab if it is now empty, unless there are enough
+     empty slabs already. */
+  if (s->in_use == 0) 
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt < SLAB_EMPTY_MAX) 
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else 
+        {
+          palloc_free_page (s);
+          c->slab_cnt--;
+        }
+    }
+
+  c->free_cnt++;
+  c->in_use--;
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for each object cache. */
+void
+kmem_cache_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e)) 
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("Slab cache %s: %zu-byte objects, %zu per slab, "
+              "%lld allocs, %lld frees, %zu peak in use, %zu slabs\n",
+              c->name, c->size, c->obj_cnt, c->alloc_cnt, c->free_cnt,
+              c->peak_in_use, c->slab_cnt);
+    }
+}
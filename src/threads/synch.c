@@ -32,6 +32,8 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+static void donate_priority (struct lock *, int priority);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -102,7 +104,9 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  If the thread woken up has a higher priority
+   than the running thread, yields the CPU to it.
 
    This function may be called from an interrupt handler. */
 void
@@ -114,10 +118,16 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      struct list_elem *e = list_max (&sema->waiters,
+                                      thread_priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+
+  thread_check_preemption ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -185,6 +195,12 @@ lock_init (struct lock *lock)
    necessary.  The lock must not already be held by the current
    thread.
 
+   While we wait, our priority is donated to the holder of LOCK
+   and, if that thread is itself waiting for a lock, onward
+   along the chain of holders, up to LOCK_DONATION_DEPTH
+   threads.  Donation is not used with the MLFQS, which computes
+   priorities itself.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +208,45 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  if (lock->holder != NULL && !thread_mlfqs)
+    {
+      cur->waiting_lock = lock;
+      donate_priority (lock, cur->priority);
+    }
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  list_push_back (&cur->held_locks, &lock->elem);
+  intr_set_level (old_level);
+}
+
+/* Donates PRIORITY to the holder of LOCK and then to the holders
+   of the locks that each holder is waiting for in turn, stopping
+   at a thread that already has at least PRIORITY or after
+   LOCK_DONATION_DEPTH threads.  Interrupts must be off. */
+static void
+donate_priority (struct lock *lock, int priority) 
+{
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; lock != NULL && depth < LOCK_DONATION_DEPTH; depth++)
+    {
+      struct thread *holder = lock->holder;
+      if (holder == NULL || holder->priority >= priority)
+        break;
+      thread_donate_priority (holder, priority);
+      lock = holder->waiting_lock;
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -209,18 +258,26 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      list_push_back (&lock->holder->held_locks, &lock->elem);
+    }
+  intr_set_level (old_level);
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Drops any priority that was donated to us through LOCK, which
+   may cause us to yield to the thread that acquires it next.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,10 +285,19 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   lock->holder = NULL;
+  list_remove (&lock->elem);
+  if (!thread_mlfqs)
+    thread_refresh_priority (cur);
+  intr_set_level (old_level);
+
   sema_up (&lock->semaphore);
 }
 
@@ -251,8 +317,11 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
+static list_less_func waiter_priority_less;
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -295,6 +364,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -302,7 +372,8 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
+   this function signals the highest-priority one of them to
+   wake up from its wait.
    LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -317,8 +388,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters,
+                                      waiter_priority_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -336,3 +411,17 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Returns true if the thread waiting on semaphore_elem A_ has
+   lower priority than the one waiting on B_. */
+static bool
+waiter_priority_less (const struct list_elem *a_,
+                      const struct list_elem *b_, void *aux UNUSED) 
+{
+  const struct semaphore_elem *a
+    = list_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b
+    = list_entry (b_, struct semaphore_elem, elem);
+
+  return a->thread->priority < b->thread->priority;
+}
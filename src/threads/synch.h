@@ -20,10 +20,20 @@ void sema_self_test (void);
 /* Lock. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct thread *holder;      /* Thread holding lock. */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's held_locks list. */
   };
 
+/* Maximum number of lock holders that a thread blocked in
+   lock_acquire() donates its priority to, following the chain
+   from the holder of the lock it wants to the holder of the lock
+   that that thread wants, and so on.  Bounds the time spent in
+   lock_acquire() with interrupts off. */
+#ifndef LOCK_DONATION_DEPTH
+#define LOCK_DONATION_DEPTH 8
+#endif
+
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
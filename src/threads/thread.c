@@ -7,10 +7,12 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/io.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,9 +22,18 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of distinct thread priorities. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Run queues of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority.  Bit P of ready_mask is
+   set if and only if ready_lists[P - PRI_MIN] is nonempty, so the
+   highest-priority ready thread is found with a single bit scan
+   instead of a list walk. */
+static struct list ready_lists[PRI_CNT];
+static uint64_t ready_mask;
+static int ready_cnt;           /* Number of threads in ready_lists. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -59,11 +70,40 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* MLFQS state.
+
+   Every thread's recent_cpu decays once per second, but a thread
+   whose recent_cpu and nice are both 0 stays at 0 and keeps its
+   priority, so the once-per-second update only needs to visit
+   the threads on mlfqs_active_list, which holds exactly those
+   threads with nonzero recent_cpu or nice.  Between those
+   updates, only the running thread's recent_cpu changes, so the
+   priority update every fourth tick only visits the threads on
+   mlfqs_ran_list, which holds the threads that have run since
+   the last such update. */
+#define MLFQS_PRI_TICKS 4               /* Ticks between priority updates. */
+static fixed_point_t load_avg;          /* System load average. */
+static struct list mlfqs_active_list;   /* Threads that need decay. */
+static struct list mlfqs_ran_list;      /* Threads that ran recently. */
+
+/* MLFQS overhead statistics, in CPU timestamp counter cycles. */
+static long long mlfqs_tick_cycles;     /* Total cycles in mlfqs_tick(). */
+static long long mlfqs_tick_max;        /* Most cycles in one call. */
+static long long mlfqs_tick_cnt;        /* Number of calls. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static void set_effective_priority (struct thread *, int priority);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_mark_active (struct thread *);
+static void mlfqs_forget (struct thread *);
+static int ready_max_priority (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
@@ -87,17 +127,26 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int pri;
+
   ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_CNT <= 64);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&ready_lists[pri - PRI_MIN]);
+  ready_mask = 0;
   list_init (&all_list);
+  list_init (&mlfqs_active_list);
+  list_init (&mlfqs_ran_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  if (thread_mlfqs)
+    mlfqs_update_priority (initial_thread);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -134,6 +183,20 @@ thread_tick (void)
   else
     kernel_ticks++;
 
+  if (thread_mlfqs)
+    {
+      uint64_t start = rdtsc ();
+      long long cycles;
+
+      mlfqs_tick (t);
+
+      cycles = rdtsc () - start;
+      mlfqs_tick_cycles += cycles;
+      mlfqs_tick_cnt++;
+      if (cycles > mlfqs_tick_max)
+        mlfqs_tick_max = cycles;
+    }
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
@@ -145,6 +208,22 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  if (thread_mlfqs && mlfqs_tick_cnt > 0)
+    printf ("MLFQS: %lld cycles per tick on average, %lld at most\n",
+            mlfqs_tick_cycles / mlfqs_tick_cnt, mlfqs_tick_max);
+}
+
+/* Stores the statistics printed by thread_print_stats() into
+   *IDLE, *KERNEL, and *USER, so that callers can measure how
+   ticks are spent over an interval. */
+void
+thread_get_stats (long long *idle, long long *kernel, long long *user)
+{
+  enum intr_level old_level = intr_disable ();
+  *idle = idle_ticks;
+  *kernel = kernel_ticks;
+  *user = user_ticks;
+  intr_set_level (old_level);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -159,9 +238,9 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, the running thread yields to it before this function
+   returns. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -184,6 +263,21 @@ thread_create (const char *name, int priority,
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
 
+  /* Under the MLFQS, the new thread inherits our nice and
+     recent_cpu and its priority is computed from them.  The
+     idle thread keeps PRI_MIN. */
+  if (thread_mlfqs && function != idle)
+    {
+      struct thread *cur = thread_current ();
+
+      old_level = intr_disable ();
+      t->nice = cur->nice;
+      t->recent_cpu = cur->recent_cpu;
+      mlfqs_update_priority (t);
+      mlfqs_mark_active (t);
+      intr_set_level (old_level);
+    }
+
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
      member cannot be observed. */
@@ -208,6 +302,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_check_preemption ();
 
   return tid;
 }
@@ -235,7 +330,11 @@ thread_block (void)
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  Call thread_check_preemption() afterward
+   to give the CPU to T if it outranks the running thread.  The
+   exception is an interrupt handler, which cannot yield
+   directly: there, a yield is requested for when the handler
+   returns. */
 void
 thread_unblock (struct thread *t) 
 {
@@ -245,8 +344,10 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  ready_push (t);
   t->status = THREAD_READY;
+  if (intr_context () && t->priority > thread_current ()->priority)
+    intr_yield_on_return ();
   intr_set_level (old_level);
 }
 
@@ -299,6 +400,7 @@ thread_exit (void)
      when it calls thread_schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current()->allelem);
+  mlfqs_forget (thread_current ());
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -316,12 +418,35 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    ready_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if some ready thread has a higher priority than
+   the running thread.  Within an interrupt handler, the yield
+   happens just before the handler returns. */
+void
+thread_check_preemption (void) 
+{
+  enum intr_level old_level;
+  bool outranked;
+
+  old_level = intr_disable ();
+  outranked = (ready_mask != 0
+               && ready_max_priority () > thread_current ()->priority);
+  intr_set_level (old_level);
+
+  if (outranked)
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -339,49 +464,259 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.
+   Priority donated to the thread through the locks it holds
+   still applies, so its effective priority may stay higher.
+   Yields if the running thread no longer has the highest
+   priority. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  /* The MLFQS computes priorities itself. */
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_refresh_priority (cur);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
 }
 
-/* Returns the current thread's priority. */
+/* Returns the current thread's effective priority. */
 int
 thread_get_priority (void) 
 {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Raises T's effective priority to PRIORITY, if PRIORITY is
+   higher.  Used by lock_acquire() to donate priority to a lock
+   holder.  Interrupts must be off. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_donate_priority (struct thread *t, int priority) 
 {
-  /* Not yet implemented. */
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (priority > t->priority)
+    set_effective_priority (t, priority);
+}
+
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities of the threads waiting for locks
+   that T holds.  Interrupts must be off. */
+void
+thread_refresh_priority (struct thread *t) 
+{
+  int priority = t->base_priority;
+  struct list_elem *e;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+       e = list_next (e))
+    {
+      struct lock *lock = list_entry (e, struct lock, elem);
+      struct list *waiters = &lock->semaphore.waiters;
+
+      if (!list_empty (waiters))
+        {
+          struct thread *donor
+            = list_entry (list_max (waiters, thread_priority_less, NULL),
+                          struct thread, elem);
+          if (donor->priority > priority)
+            priority = donor->priority;
+        }
+    }
+
+  if (priority != t->priority)
+    set_effective_priority (t, priority);
+}
+
+/* Returns true if the thread that contains A_ has lower
+   priority than the one that contains B_. */
+bool
+thread_priority_less (const struct list_elem *a_,
+                      const struct list_elem *b_, void *aux UNUSED) 
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->priority < b->priority;
+}
+
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority.  Yields if the running thread no longer has the
+   highest priority. */
+void
+thread_set_nice (int nice) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    {
+      mlfqs_update_priority (cur);
+      mlfqs_mark_active (cur);
+    }
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_round (fp_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100
+    = fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+  return recent_cpu_100;
+}
+
+/* Does the MLFQS bookkeeping for a timer tick during which CUR
+   was running.  Called from the timer interrupt handler. */
+static void
+mlfqs_tick (struct thread *cur) 
+{
+  int64_t now = timer_ticks ();
+
+  if (cur != idle_thread)
+    {
+      cur->recent_cpu = fp_add_int (cur->recent_cpu, 1);
+      mlfqs_mark_active (cur);
+      if (!cur->mlfqs_ran)
+        {
+          list_push_back (&mlfqs_ran_list, &cur->ranelem);
+          cur->mlfqs_ran = true;
+        }
+    }
+
+  if (now % TIMER_FREQ == 0)
+    {
+      /* load_avg = (59/60) * load_avg + (1/60) * ready_threads. */
+      int ready_threads = ready_cnt + (cur != idle_thread ? 1 : 0);
+      fixed_point_t decay;
+      struct list_elem *e, *next;
+
+      load_avg = fp_add (fp_div_int (fp_mul_int (load_avg, 59), 60),
+                         fp_div_int (fp_from_int (ready_threads), 60));
+
+      /* recent_cpu = decay * recent_cpu + nice, where
+         decay = (2 * load_avg) / (2 * load_avg + 1). */
+      decay = fp_div (fp_mul_int (load_avg, 2),
+                      fp_add_int (fp_mul_int (load_avg, 2), 1));
+      for (e = list_begin (&mlfqs_active_list);
+           e != list_end (&mlfqs_active_list); e = next)
+        {
+          struct thread *t = list_entry (e, struct thread, activeelem);
+          next = list_next (e);
+
+          t->recent_cpu = fp_add_int (fp_mul (decay, t->recent_cpu),
+                                      t->nice);
+          mlfqs_update_priority (t);
+          if (t->recent_cpu == 0 && t->nice == 0)
+            {
+              list_remove (&t->activeelem);
+              t->mlfqs_active = false;
+            }
+        }
+    }
+
+  if (now % MLFQS_PRI_TICKS == 0)
+    {
+      while (!list_empty (&mlfqs_ran_list))
+        {
+          struct thread *t = list_entry (list_pop_front (&mlfqs_ran_list),
+                                         struct thread, ranelem);
+          t->mlfqs_ran = false;
+          mlfqs_update_priority (t);
+        }
+      thread_check_preemption ();
+    }
+}
+
+/* Recomputes T's priority from its recent_cpu and nice:
+   priority = PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped
+   to the valid range.  Interrupts must be off. */
+static void
+mlfqs_update_priority (struct thread *t) 
+{
+  int priority = fp_trunc (fp_sub (fp_from_int (PRI_MAX - t->nice * 2),
+                                   fp_div_int (t->recent_cpu, 4)));
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  t->base_priority = priority;
+  if (priority != t->priority)
+    set_effective_priority (t, priority);
+}
+
+/* Adds T to mlfqs_active_list if it has nonzero recent_cpu or
+   nice and is not already there.  Interrupts must be off. */
+static void
+mlfqs_mark_active (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!t->mlfqs_active && (t->recent_cpu != 0 || t->nice != 0))
+    {
+      list_push_back (&mlfqs_active_list, &t->activeelem);
+      t->mlfqs_active = true;
+    }
+}
+
+/* Removes dying thread T from the MLFQS lists.  Interrupts must
+   be off. */
+static void
+mlfqs_forget (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->mlfqs_active)
+    {
+      list_remove (&t->activeelem);
+      t->mlfqs_active = false;
+    }
+  if (t->mlfqs_ran)
+    {
+      list_remove (&t->ranelem);
+      t->mlfqs_ran = false;
+    }
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -467,7 +802,15 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->held_locks);
+#ifdef USERPROG
+  t->exit_code = -1;
+  list_init (&t->children);
+#ifdef VM
+  list_init (&t->mappings);
+#endif
+#endif
   t->magic = THREAD_MAGIC;
   list_push_back (&all_list, &t->allelem);
 }
@@ -485,18 +828,90 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Adds T to the back of the run queue for its priority.
+   Interrupts must be off. */
+static void
+ready_push (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_push_back (&ready_lists[t->priority - PRI_MIN], &t->elem);
+  ready_mask |= (uint64_t) 1 << (t->priority - PRI_MIN);
+  ready_cnt++;
+}
+
+/* Removes ready thread T from its run queue.  Interrupts must be
+   off. */
+static void
+ready_remove (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_lists[t->priority - PRI_MIN]))
+    ready_mask &= ~((uint64_t) 1 << (t->priority - PRI_MIN));
+  ready_cnt--;
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching run queue if it is ready.  Interrupts must be off. */
+static void
+set_effective_priority (struct thread *t, int priority) 
+{
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->status == THREAD_READY && t != idle_thread)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    t->priority = priority;
+}
+
+/* Returns the highest priority that has a nonempty run queue.
+   There must be at least one ready thread. */
+static int
+ready_max_priority (void) 
+{
+  uint32_t high = ready_mask >> 32;
+  uint32_t low = ready_mask;
+
+  ASSERT (ready_mask != 0);
+  if (high != 0)
+    return PRI_MIN + 63 - __builtin_clz (high);
+  else
+    return PRI_MIN + 31 - __builtin_clz (low);
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   idle_thread.
+
+   The thread chosen is the one at the front of the
+   highest-priority nonempty queue, so threads of equal priority
+   are served round-robin. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  struct list *queue;
+  struct list_elem *e;
+  int pri;
+
+  if (ready_mask == 0)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  pri = ready_max_priority ();
+  queue = &ready_lists[pri - PRI_MIN];
+  e = list_pop_front (queue);
+  ready_cnt--;
+  if (list_empty (queue))
+    ready_mask &= ~((uint64_t) 1 << (pri - PRI_MIN));
+  return list_entry (e, struct thread, elem);
 }
 
 /* Completes a thread switch by activating the new thread's page
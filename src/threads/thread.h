@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -24,6 +25,13 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread nice values, used by the MLFQS. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default nice value. */
+#define NICE_MAX 20                     /* Least nice. */
+
+struct lock;
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -79,7 +87,9 @@ typedef int tid_t;
    semaphore wait list (synch.c).  It can be used these two ways
    only because they are mutually exclusive: only a thread in the
    ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   blocked state is on a semaphore wait list.  A thread sleeping
+   in timer_sleep() is blocked but on no semaphore, so
+   devices/timer.c borrows `elem' for its sleep list too. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -87,15 +97,47 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority. */
+    int base_priority;                  /* Priority before donations. */
     struct list_elem allelem;           /* List element for all threads list. */
 
+    /* Owned by thread.c, used only by the MLFQS. */
+    int nice;                           /* Niceness. */
+    fixed_point_t recent_cpu;           /* Recent CPU time received. */
+    bool mlfqs_active;                  /* In mlfqs_active_list? */
+    struct list_elem activeelem;        /* mlfqs_active_list element. */
+    bool mlfqs_ran;                     /* In mlfqs_ran_list? */
+    struct list_elem ranelem;           /* mlfqs_ran_list element. */
+
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct list held_locks;             /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being acquired, if any. */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick at which to wake up. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    int exit_code;                      /* Exit code reported to parent. */
+    struct wait_status *wait_status;    /* This process's completion state. */
+    struct list children;               /* Completion state of children. */
+    struct file *bin_file;              /* Executable, kept write-denied. */
+    struct dir *cwd;                    /* Working directory, null for root. */
+#ifdef VM
+    struct hash *pages;                 /* Supplemental page table. */
+    void *user_esp;                     /* User's stack pointer. */
+#endif
+
+    /* Owned by userprog/syscall.c. */
+    struct file **fds;                  /* Open files, indexed by fd - 2. */
+    int fd_cnt;                         /* Number of slots in fds. */
+    char *exec_buf;                     /* Page reused by exec, or null. */
+#ifdef VM
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Next mapping identifier. */
+#endif
 #endif
 
     /* Owned by thread.c. */
@@ -112,6 +154,7 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_get_stats (long long *idle, long long *kernel, long long *user);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -125,6 +168,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_check_preemption (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -132,6 +176,9 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, int);
+void thread_refresh_priority (struct thread *);
+list_less_func thread_priority_less;
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -4,6 +4,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -148,6 +152,34 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* A fault in the user program may grow its stack, judged by
+     its stack pointer.  A fault in the kernel uses the one saved
+     on entry to the system call instead. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+
+  /* Bring in the page if it belongs to the process but is not
+     resident, or give it a private copy if it is shared and
+     this is the first write to it, whether the fault came from
+     the user program or from the kernel touching user memory on
+     its behalf. */
+  if ((not_present || write) && is_user_vaddr (fault_addr)
+      && page_in (fault_addr, write))
+    return;
+#endif
+
+  /* A fault in the kernel at a user address comes from
+     get_user() or put_user() in syscall.c, which put the address
+     to resume at in %eax.  Resume there with %eax set to -1 to
+     report the failure. */
+  if (!user && is_user_vaddr (fault_addr))
+    {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0xffffffff;
+      return;
+    }
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
@@ -3,11 +3,37 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/loader.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* Number of page directory entries for user virtual addresses. */
+#define USER_PDE_CNT (LOADER_PHYS_BASE >> PDSHIFT)
+
+/* Bookkeeping for a user page directory, kept in the page that
+   follows it, so that destroying the page directory need only
+   visit the page tables it actually has, and scan only those
+   that still map pages. */
+struct pagedir_info
+  {
+    uint16_t pt_cnt;                    /* Number of page tables. */
+    uint16_t pts[USER_PDE_CNT];         /* Their page directory indexes. */
+    uint16_t present[USER_PDE_CNT];     /* Present PTEs, by PD index. */
+  };
+
+/* Number of pages that pagedir_destroy() frees at a time. */
+#define FREE_BATCH 64
+
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+
+/* Returns the bookkeeping for user page directory PD. */
+static struct pagedir_info *
+pagedir_info (uint32_t *pd) 
+{
+  ASSERT (pd != init_page_dir);
+  return (struct pagedir_info *) ((uint8_t *) pd + PGSIZE);
+}
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -16,35 +42,61 @@ static void invalidate_pagedir (uint32_t *);
 uint32_t *
 pagedir_create (void) 
 {
-  uint32_t *pd = palloc_get_page (0);
+  uint32_t *pd = palloc_get_multiple (0, 2);
   if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+    {
+      memcpy (pd, init_page_dir, PGSIZE);
+      pagedir_info (pd)->pt_cnt = 0;
+    }
   return pd;
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  Visits only PD's page tables, scanning each only
+   as far as its last present page, and returns the pages to
+   palloc in batches, so that the time taken follows the
+   process's resident pages rather than the span of its address
+   space. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
-  uint32_t *pde;
+  struct pagedir_info *info;
+  void *pages[FREE_BATCH];
+  size_t page_cnt = 0;
+  size_t i;
 
   if (pd == NULL)
     return;
 
-  ASSERT (pd != init_page_dir);
-  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
-      {
-        uint32_t *pt = pde_get_pt (*pde);
-        uint32_t *pte;
-        
-        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
-        palloc_free_page (pt);
-      }
-  palloc_free_page (pd);
+  info = pagedir_info (pd);
+  for (i = 0; i < info->pt_cnt; i++) 
+    {
+      size_t pde_idx = info->pts[i];
+      uint32_t *pt = pde_get_pt (pd[pde_idx]);
+      size_t left = info->present[pde_idx];
+      uint32_t *pte;
+
+      for (pte = pt; left > 0; pte++)
+        if (*pte & PTE_P) 
+          {
+            pages[page_cnt++] = pte_get_page (*pte);
+            if (page_cnt == FREE_BATCH)
+              {
+                palloc_free_pages (pages, page_cnt);
+                page_cnt = 0;
+              }
+            left--;
+          }
+
+      pages[page_cnt++] = pt;
+      if (page_cnt == FREE_BATCH)
+        {
+          palloc_free_pages (pages, page_cnt);
+          page_cnt = 0;
+        }
+    }
+  palloc_free_pages (pages, page_cnt);
+  palloc_free_multiple (pd, 2);
 }
 
 /* Returns the address of the page table entry for virtual
@@ -70,11 +122,15 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
     {
       if (create)
         {
+          struct pagedir_info *info = pagedir_info (pd);
+
           pt = palloc_get_page (PAL_ZERO);
           if (pt == NULL) 
             return NULL; 
       
           *pde = pde_create (pt);
+          info->pts[info->pt_cnt++] = pd_no (vaddr);
+          info->present[pd_no (vaddr)] = 0;
         }
       else
         return NULL;
@@ -112,6 +168,7 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     {
       ASSERT ((*pte & PTE_P) == 0);
       *pte = pte_create_user (kpage, writable);
+      pagedir_info (pd)->present[pd_no (upage)]++;
       return true;
     }
   else
@@ -152,7 +209,8 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      pagedir_info (pd)->present[pd_no (upage)]--;
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +238,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,7 +267,7 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -245,19 +303,23 @@ active_pd (void)
 
 /* Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the stale
+   TLB entry.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for user virtual page
+   VPAGE if PD is the active page directory.  (If PD is not
+   active then its entries are not in the TLB, so there is no
+   need to invalidate anything.)  Unlike re-activating PD, which
+   would flush the whole TLB, this leaves the process's other
+   translations in place. */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_page (uint32_t *pd, const void *vpage) 
 {
   if (active_pd () == pd) 
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      /* See [IA32-v3a] 3.12 "Translation Lookaside Buffers
+         (TLBs)" and [IA32-v2a] "INVLPG--Invalidate TLB
+         Entry". */
+      asm volatile ("invlpg (%0)" : : "r" (vpage) : "memory");
     } 
 }
@@ -7,6 +7,7 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -14,43 +15,82 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Data structure shared between process_execute() in the
+   invoking thread and start_process() in the newly invoked
+   thread. */
+struct exec_info 
+  {
+    const char *cmd_line;               /* Command line to execute. */
+    struct semaphore load_done;         /* "Up"ed when loading complete. */
+    struct wait_status *wait_status;    /* Child process. */
+    struct dir *cwd;                    /* Parent's working directory. */
+    bool success;                       /* Program successfully loaded? */
+  };
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (const char *cmd_line, void (**eip) (void), void **esp);
+static void release_child (struct wait_status *);
 
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   FILENAME, which is a command line of up to PGSIZE - 1 bytes
+   whose first word names the program.  Waits until the program
+   has been loaded, so that the caller learns whether it
+   succeeded.  Returns the new process's thread id, or TID_ERROR
+   if the thread cannot be created or the program cannot be
+   loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct exec_info exec;
+  char thread_name[16];
+  char *name, *save_ptr;
   tid_t tid;
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  /* The new thread reads FILE_NAME directly, without making a
+     copy, which is safe because we do not return until it has
+     finished loading. */
+  exec.cmd_line = file_name;
+  exec.cwd = thread_current ()->cwd;
+  sema_init (&exec.load_done, 0);
+
+  /* Create a new thread to execute FILE_NAME, named after the
+     program rather than the whole command line. */
+  while (*file_name == ' ')
+    file_name++;
+  strlcpy (thread_name, file_name, sizeof thread_name);
+  name = strtok_r (thread_name, " ", &save_ptr);
+  if (name == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  tid = thread_create (name, PRI_DEFAULT, start_process, &exec);
+  if (tid != TID_ERROR)
+    {
+      sema_down (&exec.load_done);
+      if (exec.success)
+        list_push_back (&thread_current ()->children,
+                        &exec.wait_status->elem);
+      else
+        tid = TID_ERROR;
+    }
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
-  if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *exec_)
 {
-  char *file_name = file_name_;
+  struct exec_info *exec = exec_;
+  struct thread *cur = thread_current ();
   struct intr_frame if_;
   bool success;
 
@@ -59,10 +99,41 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
 
-  /* If load failed, quit. */
-  palloc_free_page (file_name);
+  /* Start out in the parent's working directory, which is then
+     used to find the executable. */
+  success = true;
+  if (exec->cwd != NULL) 
+    {
+      lock_acquire (&filesys_lock);
+      cur->cwd = dir_reopen (exec->cwd);
+      lock_release (&filesys_lock);
+      success = cur->cwd != NULL;
+    }
+  if (success)
+    success = load (exec->cmd_line, &if_.eip, &if_.esp);
+
+  /* Allocate wait_status. */
+  if (success)
+    {
+      exec->wait_status = cur->wait_status
+        = malloc (sizeof *exec->wait_status);
+      success = exec->wait_status != NULL;
+    }
+
+  /* Initialize wait_status. */
+  if (success) 
+    {
+      lock_init (&exec->wait_status->lock);
+      exec->wait_status->ref_cnt = 2;
+      exec->wait_status->tid = cur->tid;
+      exec->wait_status->exit_code = -1;
+      sema_init (&exec->wait_status->dead, 0);
+    }
+
+  /* Notify parent thread and clean up. */
+  exec->success = success;
+  sema_up (&exec->load_done);
   if (!success) 
     thread_exit ();
 
@@ -76,18 +147,47 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Releases one reference to CS and, if it is now unreferenced,
+   frees it. */
+static void
+release_child (struct wait_status *cs) 
+{
+  int new_ref_cnt;
+  
+  lock_acquire (&cs->lock);
+  new_ref_cnt = --cs->ref_cnt;
+  lock_release (&cs->lock);
+
+  if (new_ref_cnt == 0)
+    free (cs);
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = list_next (e)) 
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      if (cs->tid == child_tid) 
+        {
+          int exit_code;
+          list_remove (e);
+          sema_down (&cs->dead);
+          exit_code = cs->exit_code;
+          release_child (cs);
+          return exit_code;
+        }
+    }
   return -1;
 }
 
@@ -96,8 +196,50 @@ void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
   uint32_t *pd;
 
+  /* Report the exit to the console and to our parent. */
+  if (cur->pagedir != NULL)
+    printf ("%s: exit(%d)\n", cur->name, cur->exit_code);
+  if (cur->wait_status != NULL) 
+    {
+      struct wait_status *cs = cur->wait_status;
+      cs->exit_code = cur->exit_code;
+      sema_up (&cs->dead);
+      release_child (cs);
+    }
+
+  /* Free entries of children list. */
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = next) 
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      next = list_remove (e);
+      release_child (cs);
+    }
+
+  /* Close open files, including the executable, which allows
+     writes to it again, and the working directory. */
+  syscall_exit ();
+
+#ifdef VM
+  /* Release the process's frames while its page directory still
+     maps them, and before closing the executable, whose inode
+     identifies its pages in the share table. */
+  page_exit ();
+#endif
+
+  if (cur->bin_file != NULL || cur->cwd != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (cur->bin_file);
+      dir_close (cur->cwd);
+      lock_release (&filesys_lock);
+      cur->bin_file = NULL;
+      cur->cwd = NULL;
+    }
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -195,39 +337,60 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+static bool setup_stack (const char *cmd_line, void **esp,
+                         const char **file_name);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
+/* Loads the ELF executable named by the first word of CMD_LINE
+   into the current thread, passing it the words of CMD_LINE as
+   arguments.  Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const char *cmd_line, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
+  const char *file_name;
   off_t file_ofs;
   bool success = false;
   int i;
 
+  lock_acquire (&filesys_lock);
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
 
-  /* Open executable file. */
+#ifdef VM
+  /* Create the supplemental page table. */
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    goto done;
+  hash_init (t->pages, page_hash, page_less, NULL);
+#endif
+
+  /* Set up stack.  This also splits the command line into
+     arguments, the first of which is the program's name. */
+  if (!setup_stack (cmd_line, esp, &file_name))
+    goto done;
+
+  /* Open executable file.  Keep it open, with writes denied,
+     for as long as the process runs. */
   file = filesys_open (file_name);
   if (file == NULL) 
     {
       printf ("load: %s: open failed\n", file_name);
       goto done; 
     }
+  file_deny_write (file);
+  t->bin_file = file;
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -301,24 +464,23 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
-
   /* Start address. */
   *eip = (void (*) (void)) ehdr.e_entry;
 
   success = true;
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  /* We arrive here whether the load is successful or not.
+     The executable is closed by process_exit(). */
+  lock_release (&filesys_lock);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -377,6 +539,13 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, nothing is read here: each page is only
+   recorded in the supplemental page table, and page_fault()
+   reads it from FILE, or zeroes it, the first time it is
+   touched.  Pages read from FILE are shared, read-only, with
+   other processes running the same executable, until the
+   process first writes to them.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -387,7 +556,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek (file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -396,6 +567,19 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where to find this page. */
+      struct page *p = page_allocate (upage, !writable);
+      if (p == NULL)
+        return false;
+      if (page_read_bytes > 0) 
+        {
+          p->file = file;
+          p->file_offset = ofs;
+          p->file_bytes = page_read_bytes;
+          p->sharable = true;
+        }
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -415,35 +599,109 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
       upage += PGSIZE;
     }
   return true;
 }
 
-/* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+/* Creates a stack at the top of user virtual memory holding the
+   arguments in CMD_LINE, set up for a call to main(argc, argv)
+   per the 80x86 calling convention.  Stores the initial stack
+   pointer into *ESP and the program name, argv[0], into
+   *FILE_NAME.
+
+   The command line is copied onto the new stack only once and
+   split into arguments there in place, so no other copy of it
+   is needed.  A command line of up to PGSIZE - 1 bytes may
+   need a second stack page to hold the argv array, so we map
+   as many pages as the worst case requires, leaving at least
+   MAIN_FRAME_MIN bytes below the arguments for main() itself. */
+#define MAIN_FRAME_MIN 1024
 static bool
-setup_stack (void **esp) 
+setup_stack (const char *cmd_line, void **esp, const char **file_name) 
 {
-  uint8_t *kpage;
-  bool success = false;
+  size_t cmd_len = strnlen (cmd_line, PGSIZE - 1);
+  size_t max_argc = (cmd_len + 1) / 2;
+  size_t stack_size = (cmd_len + 1 + sizeof (char *) - 1
+                       + (max_argc + 1) * sizeof (char *)
+                       + sizeof (char **) + sizeof (int) + sizeof (void *));
+  uint8_t *upage = PHYS_BASE;
+  char *cmd_copy, *arg, *save_ptr;
+  char **argv;
+  uint32_t *sp;
+  int argc, i;
+
+  /* Map zeroed stack pages.  On failure, any pages already
+     mapped are freed along with the page directory.  With
+     virtual memory the pages are only reserved here, and fault
+     in as the arguments are written below. */
+  while (upage > (uint8_t *) PHYS_BASE - stack_size - MAIN_FRAME_MIN) 
+    {
+#ifdef VM
+      upage -= PGSIZE;
+      if (page_allocate (upage, false) == NULL)
+        return false;
+#else
+      uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+      upage -= PGSIZE;
+      if (kpage == NULL)
+        return false;
+      if (!install_page (upage, kpage, true)) 
+        {
+          palloc_free_page (kpage);
+          return false;
+        }
+#endif
+    }
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+  /* Copy the command line to the top of the stack.  The page
+     directory is active, so we can write through user
+     addresses directly. */
+  cmd_copy = (char *) PHYS_BASE - (cmd_len + 1);
+  memcpy (cmd_copy, cmd_line, cmd_len);
+  cmd_copy[cmd_len] = '\0';
+
+  /* Split it into arguments, storing a pointer to each one in
+     turn below the last, under a null argv[argc] sentinel. */
+  argv = (char **) ROUND_DOWN ((uintptr_t) cmd_copy, sizeof (char *)) - 1;
+  *argv = NULL;
+  argc = 0;
+  for (arg = strtok_r (cmd_copy, " ", &save_ptr); arg != NULL;
+       arg = strtok_r (NULL, " ", &save_ptr)) 
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE;
-      else
-        palloc_free_page (kpage);
+      *--argv = arg;
+      argc++;
     }
-  return success;
+  if (argc == 0)
+    return false;
+
+  /* The pointers went down in reverse order, so swap them
+     into place. */
+  for (i = 0; i < argc / 2; i++) 
+    {
+      char *tmp = argv[i];
+      argv[i] = argv[argc - 1 - i];
+      argv[argc - 1 - i] = tmp;
+    }
+
+  /* Push argv, argc, and a fake return address. */
+  sp = (uint32_t *) argv;
+  *--sp = (uint32_t) argv;
+  *--sp = argc;
+  *--sp = 0;
+
+  *esp = sp;
+  *file_name = argv[0];
+  return true;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -463,3 +721,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
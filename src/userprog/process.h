@@ -1,8 +1,24 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include "threads/synch.h"
 #include "threads/thread.h"
 
+/* Tracks the completion of a child process.
+   Shared between the child and its parent, and freed by
+   whichever of the two exits last. */
+struct wait_status
+  {
+    struct list_elem elem;              /* `children' list element. */
+    struct lock lock;                   /* Protects ref_cnt. */
+    int ref_cnt;                        /* 2=child and parent both alive,
+                                           1=either child or parent alive,
+                                           0=child and parent both dead. */
+    tid_t tid;                          /* Child thread id. */
+    int exit_code;                      /* Child exit code, if dead. */
+    struct semaphore dead;              /* Upped when the child dies. */
+  };
+
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
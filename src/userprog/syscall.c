@@ -1,20 +1,837 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* A system call implementation.  ARGS holds the argument words
+   copied from the user stack.  The return value is passed back
+   to the user process in %eax. */
+typedef int syscall_func (const uint32_t *args);
+
+/* A system call. */
+struct syscall
+  {
+    int arg_cnt;                /* Number of argument words. */
+    syscall_func *func;         /* Implementation. */
+  };
+
+static syscall_func sys_halt, sys_exit, sys_exec, sys_wait;
+static syscall_func sys_create, sys_remove, sys_open, sys_filesize;
+static syscall_func sys_read, sys_write, sys_seek, sys_tell, sys_close;
+static syscall_func sys_chdir, sys_mkdir, sys_readdir, sys_isdir;
+static syscall_func sys_inumber;
+#ifdef VM
+static syscall_func sys_mmap, sys_munmap;
+#endif
+
+/* Table of system calls, indexed by system call number.  Calls
+   whose FUNC is null are not implemented, and invoking them
+   terminates the process. */
+static const struct syscall syscall_table[] =
+  {
+    [SYS_HALT] = {0, sys_halt},
+    [SYS_EXIT] = {1, sys_exit},
+    [SYS_EXEC] = {1, sys_exec},
+    [SYS_WAIT] = {1, sys_wait},
+    [SYS_CREATE] = {2, sys_create},
+    [SYS_REMOVE] = {1, sys_remove},
+    [SYS_OPEN] = {1, sys_open},
+    [SYS_FILESIZE] = {1, sys_filesize},
+    [SYS_READ] = {3, sys_read},
+    [SYS_WRITE] = {3, sys_write},
+    [SYS_SEEK] = {2, sys_seek},
+    [SYS_TELL] = {1, sys_tell},
+    [SYS_CLOSE] = {1, sys_close},
+    [SYS_CHDIR] = {1, sys_chdir},
+    [SYS_MKDIR] = {1, sys_mkdir},
+    [SYS_READDIR] = {2, sys_readdir},
+    [SYS_ISDIR] = {1, sys_isdir},
+    [SYS_INUMBER] = {1, sys_inumber},
+#ifdef VM
+    [SYS_MMAP] = {2, sys_mmap},
+    [SYS_MUNMAP] = {1, sys_munmap},
+#endif
+  };
+
+/* Number of entries in syscall_table. */
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* Maximum number of argument words taken by any system call. */
+#define SYSCALL_MAX_ARGS 3
+
+/* Serializes file system operations. */
+struct lock filesys_lock;
 
 static void syscall_handler (struct intr_frame *);
+static void copy_in (void *, const void *, size_t);
+static char *copy_in_string (const char *);
+static void verify_user (const void *, size_t, bool writable);
+static int file_io (struct file *, uint8_t *, unsigned size, bool write);
+static struct file *lookup_fd (int fd);
+static int install_fd (struct file *);
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  lock_init (&filesys_lock);
+}
+
+/* System call handler.  Looks up the system call number pushed
+   by the user in syscall_table, copies in the number of argument
+   words that the call takes, and invokes it. */
+static void
+syscall_handler (struct intr_frame *f)
+{
+  const struct syscall *sc;
+  uint32_t args[SYSCALL_MAX_ARGS];
+  unsigned call_nr;
+
+#ifdef VM
+  /* Save the user stack pointer, so that faults on user memory
+     in the system call can tell whether they grow the stack. */
+  thread_current ()->user_esp = f->esp;
+#endif
+
+  /* Get the system call. */
+  copy_in (&call_nr, f->esp, sizeof call_nr);
+  if (call_nr >= SYSCALL_CNT || syscall_table[call_nr].func == NULL)
+    thread_exit ();
+  sc = syscall_table + call_nr;
+
+  /* Get the system call arguments. */
+  ASSERT (sc->arg_cnt <= SYSCALL_MAX_ARGS);
+  copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * sc->arg_cnt);
+
+  /* Execute the system call, and set the return value. */
+  f->eax = sc->func (args);
+}
+
+/* Returns true if the SIZE bytes starting at UADDR all lie
+   below PHYS_BASE. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Reads a byte at user virtual address UADDR, which must be
+   below PHYS_BASE.  Returns the byte value if successful, -1 if
+   a page fault occurred.
+
+   Instead of walking the page table, we just make the access
+   and let page_fault() in exception.c catch the fault: it
+   copies %eax, which holds the address of the instruction after
+   the access, into %eip, and sets %eax to -1. */
+static inline int
+get_user (const uint8_t *uaddr)
+{
+  int result;
+  asm volatile ("movl $1f, %0; movzbl %1, %0; 1:"
+                : "=&a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST, which must be below
+   PHYS_BASE.  Returns true if successful, false if a page fault
+   occurred. */
+static inline bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error_code;
+  asm volatile ("movl $1f, %0; movb %b2, %1; 1:"
+                : "=&a" (error_code), "=m" (*udst) : "q" (byte));
+  return error_code != -1;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Calls thread_exit() if any of the user accesses are
+   invalid. */
+static void
+copy_in (void *dst_, const void *usrc_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *usrc = usrc_;
+
+  if (!is_user_range (usrc, size))
+    thread_exit ();
+  for (; size > 0; size--, dst++, usrc++)
+    {
+      int byte = get_user (usrc);
+      if (byte == -1)
+        thread_exit ();
+      *dst = byte;
+    }
+}
+
+/* Copies user string US into KS, a page of kernel memory,
+   truncating it at PGSIZE bytes in size.  Returns true if
+   successful, false if any of the user accesses are invalid. */
+static bool
+copy_string_to_page (char *ks, const char *us)
+{
+  size_t length;
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      int c;
+
+      if ((uintptr_t) us + length >= (uintptr_t) PHYS_BASE
+          || (c = get_user ((const uint8_t *) us + length)) == -1)
+        return false;
+      ks[length] = c;
+      if (c == '\0')
+        return true;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return true;
 }
 
+/* Creates a copy of user string US in kernel memory and returns
+   it as a page that must be freed with palloc_free_page().
+   Truncates the string at PGSIZE bytes in size.  Calls
+   thread_exit() if any of the user accesses are invalid. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    thread_exit ();
+
+  if (!copy_string_to_page (ks, us))
+    {
+      palloc_free_page (ks);
+      thread_exit ();
+    }
+  return ks;
+}
+
+/* Checks that the SIZE bytes starting at user address UADDR are
+   mapped, and writable if WRITABLE is true, so that the kernel
+   may then access them directly.  Touches one byte per page
+   rather than checking every byte.  Calls thread_exit() if the
+   range is invalid. */
+static void
+verify_user (const void *uaddr, size_t size, bool writable)
+{
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  uint8_t *page;
+
+  if (size == 0)
+    return;
+  if (!is_user_range (uaddr, size))
+    thread_exit ();
+  for (page = pg_round_down (uaddr); page < end; page += PGSIZE)
+    {
+      int byte = get_user (page);
+      if (byte == -1 || (writable && !put_user (page, byte)))
+        thread_exit ();
+    }
+}
+
+#ifdef VM
+/* Most pages of a user buffer that file_io() locks at once. */
+#define FILE_IO_PAGES 16
+
+/* Unlocks the pages spanned by the SIZE bytes at UADDR, which
+   must have been locked with lock_user(). */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+unlock_user (const void *uaddr, size_t size)
 {
-  printf ("system call!\n");
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  const uint8_t *page;
+
+  for (page = pg_round_down (uaddr); page < end; page += PGSIZE)
+    page_unlock (page);
+}
+
+/* Locks the pages spanned by the SIZE bytes at UADDR, which must
+   be nonzero, into memory.  If WILL_WRITE is true, they must be
+   writable.  Returns true if successful, or false, with no pages
+   left locked, on failure. */
+static bool
+lock_user (const void *uaddr, size_t size, bool will_write)
+{
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  const uint8_t *page;
+
+  for (page = pg_round_down (uaddr); page < end; page += PGSIZE)
+    if (!page_lock (page, will_write))
+      {
+        if (page > (const uint8_t *) pg_round_down (uaddr))
+          unlock_user (uaddr, page - (const uint8_t *) uaddr);
+        return false;
+      }
+  return true;
+}
+#endif
+
+/* Reads (if WRITE is false) or writes SIZE bytes between FILE
+   and the user buffer UBUF, and returns the number of bytes
+   transferred.
+
+   Without virtual memory the buffer is checked once and then
+   used directly.  With it, a page of the buffer could fault
+   while filesys_lock is held, and paging it in from the
+   executable would then reenter the file system, so the buffer
+   is instead locked into memory up to FILE_IO_PAGES pages at a
+   time, each group for the length of its own transfer.  Groups
+   of several pages let large transfers reach the disk as
+   multi-sector requests.
+
+   Reads do not take filesys_lock, so that processes reading
+   files can have several disk requests outstanding at once for
+   the disk scheduler to order.  This is safe because a file's
+   length grows only after its new data has been written, new
+   index sectors are zeroed before they are linked in, and the
+   buffer cache does its own locking. */
+static int
+file_io (struct file *file, uint8_t *ubuf, unsigned size, bool write)
+{
+  int total;
+
+#ifdef VM
+  total = 0;
+  while (size > 0)
+    {
+      size_t group_left = FILE_IO_PAGES * PGSIZE - pg_ofs (ubuf);
+      size_t chunk = size < group_left ? size : group_left;
+      off_t retval;
+
+      if (!is_user_range (ubuf, chunk) || !lock_user (ubuf, chunk, !write))
+        thread_exit ();
+      if (write) 
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_write (file, ubuf, chunk);
+          lock_release (&filesys_lock);
+        }
+      else
+        retval = file_read (file, ubuf, chunk);
+      unlock_user (ubuf, chunk);
+
+      total += retval;
+      if (retval != (off_t) chunk)
+        break;
+      ubuf += chunk;
+      size -= chunk;
+    }
+#else
+  verify_user (ubuf, size, !write);
+  if (write) 
+    {
+      lock_acquire (&filesys_lock);
+      total = file_write (file, ubuf, size);
+      lock_release (&filesys_lock);
+    }
+  else
+    total = file_read (file, ubuf, size);
+#endif
+
+  return total;
+}
+
+/* Halt system call. */
+static int
+sys_halt (const uint32_t *args UNUSED)
+{
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static int
+sys_exit (const uint32_t *args)
+{
+  thread_current ()->exit_code = (int) args[0];
   thread_exit ();
 }
+
+/* Exec system call.  The command line is copied into a page
+   that the process keeps from one exec to the next, instead of
+   a fresh page each time.  process_execute() does not return
+   until the child has finished reading it. */
+static int
+sys_exec (const uint32_t *args)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->exec_buf == NULL)
+    {
+      cur->exec_buf = palloc_get_page (0);
+      if (cur->exec_buf == NULL)
+        return TID_ERROR;
+    }
+  if (!copy_string_to_page (cur->exec_buf, (const char *) args[0]))
+    thread_exit ();
+  return process_execute (cur->exec_buf);
+}
+
+/* Wait system call. */
+static int
+sys_wait (const uint32_t *args)
+{
+  return process_wait ((tid_t) args[0]);
+}
+
+/* Create system call. */
+static int
+sys_create (const uint32_t *args)
+{
+  char *kfile = copy_in_string ((const char *) args[0]);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_create (kfile, (off_t) args[1]);
+  lock_release (&filesys_lock);
+  palloc_free_page (kfile);
+
+  return ok;
+}
+
+/* Remove system call. */
+static int
+sys_remove (const uint32_t *args)
+{
+  char *kfile = copy_in_string ((const char *) args[0]);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_remove (kfile);
+  lock_release (&filesys_lock);
+  palloc_free_page (kfile);
+
+  return ok;
+}
+
+/* Open system call. */
+static int
+sys_open (const uint32_t *args)
+{
+  char *kfile = copy_in_string ((const char *) args[0]);
+  struct file *file;
+  int fd = -1;
+
+  lock_acquire (&filesys_lock);
+  file = filesys_open (kfile);
+  if (file != NULL)
+    {
+      fd = install_fd (file);
+      if (fd == -1)
+        file_close (file);
+    }
+  lock_release (&filesys_lock);
+  palloc_free_page (kfile);
+
+  return fd;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (const uint32_t *args)
+{
+  struct file *file = lookup_fd ((int) args[0]);
+  int size;
+
+  if (file == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  size = file_length (file);
+  lock_release (&filesys_lock);
+
+  return size;
+}
+
+/* Returns true if FILE is a directory. */
+static bool
+is_dir (struct file *file)
+{
+  return inode_is_dir (file_get_inode (file));
+}
+
+/* Read system call.  Reads straight into the user buffer, which
+   must be mapped and writable.  Fails on directories, which must
+   be read with readdir. */
+static int
+sys_read (const uint32_t *args)
+{
+  int fd = (int) args[0];
+  uint8_t *udst = (uint8_t *) args[1];
+  unsigned size = args[2];
+  struct file *file;
+
+  if (fd == STDIN_FILENO)
+    {
+      unsigned i;
+
+      verify_user (udst, size, true);
+      for (i = 0; i < size; i++)
+        udst[i] = input_getc ();
+      return size;
+    }
+
+  file = lookup_fd (fd);
+  if (file == NULL || is_dir (file))
+    return -1;
+  if (size == 0)
+    return 0;
+
+  return file_io (file, udst, size, false);
+}
+
+/* Write system call.  Writes straight from the user buffer,
+   which must be mapped.  Fails on directories. */
+static int
+sys_write (const uint32_t *args)
+{
+  int fd = (int) args[0];
+  const uint8_t *usrc = (const uint8_t *) args[1];
+  unsigned size = args[2];
+  struct file *file;
+
+  if (fd == STDOUT_FILENO)
+    {
+      verify_user (usrc, size, false);
+      putbuf ((const char *) usrc, size);
+      return size;
+    }
+
+  file = lookup_fd (fd);
+  if (file == NULL || is_dir (file))
+    return -1;
+  if (size == 0)
+    return 0;
+
+  return file_io (file, (uint8_t *) usrc, size, true);
+}
+
+/* Seek system call. */
+static int
+sys_seek (const uint32_t *args)
+{
+  struct file *file = lookup_fd ((int) args[0]);
+
+  if (file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_seek (file, (off_t) args[1]);
+      lock_release (&filesys_lock);
+    }
+  return 0;
+}
+
+/* Tell system call. */
+static int
+sys_tell (const uint32_t *args)
+{
+  struct file *file = lookup_fd ((int) args[0]);
+  int position;
+
+  if (file == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  position = file_tell (file);
+  lock_release (&filesys_lock);
+
+  return position;
+}
+
+/* Close system call. */
+static int
+sys_close (const uint32_t *args)
+{
+  struct thread *cur = thread_current ();
+  int fd = (int) args[0];
+  struct file *file = lookup_fd (fd);
+
+  if (file != NULL)
+    {
+      cur->fds[fd - 2] = NULL;
+      lock_acquire (&filesys_lock);
+      file_close (file);
+      lock_release (&filesys_lock);
+    }
+  return 0;
+}
+
+/* Chdir system call. */
+static int
+sys_chdir (const uint32_t *args)
+{
+  char *kdir = copy_in_string ((const char *) args[0]);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_chdir (kdir);
+  lock_release (&filesys_lock);
+  palloc_free_page (kdir);
+
+  return ok;
+}
+
+/* Mkdir system call. */
+static int
+sys_mkdir (const uint32_t *args)
+{
+  char *kdir = copy_in_string ((const char *) args[0]);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_mkdir (kdir);
+  lock_release (&filesys_lock);
+  palloc_free_page (kdir);
+
+  return ok;
+}
+
+/* Readdir system call.  The directory's position is kept as the
+   file position of FD, so that successive calls return
+   successive entries. */
+static int
+sys_readdir (const uint32_t *args)
+{
+  struct file *file = lookup_fd ((int) args[0]);
+  char *uname = (char *) args[1];
+  char name[NAME_MAX + 1];
+  struct dir *dir;
+  bool ok = false;
+
+  if (file == NULL || !is_dir (file))
+    return false;
+
+  lock_acquire (&filesys_lock);
+  dir = dir_open (inode_reopen (file_get_inode (file)));
+  if (dir != NULL)
+    {
+      dir_seek (dir, file_tell (file));
+      ok = dir_readdir (dir, name);
+      file_seek (file, dir_tell (dir));
+      dir_close (dir);
+    }
+  lock_release (&filesys_lock);
+
+  if (ok)
+    {
+      size_t size = strlen (name) + 1;
+      verify_user (uname, size, true);
+      memcpy (uname, name, size);
+    }
+  return ok;
+}
+
+/* Isdir system call. */
+static int
+sys_isdir (const uint32_t *args)
+{
+  struct file *file = lookup_fd ((int) args[0]);
+  return file != NULL && is_dir (file);
+}
+
+/* Inumber system call. */
+static int
+sys_inumber (const uint32_t *args)
+{
+  struct file *file = lookup_fd ((int) args[0]);
+  return file != NULL ? (int) inode_get_inumber (file_get_inode (file)) : -1;
+}
+
+#ifdef VM
+/* A memory-mapped file. */
+struct mapping
+  {
+    struct list_elem elem;      /* List element in thread's mappings. */
+    int handle;                 /* Mapping id. */
+    struct file *file;          /* File, reopened for the mapping. */
+    uint8_t *base;              /* Start of memory mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+
+/* Removes mapping M from the running process, writing its
+   modified pages back to its file, and frees it. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  list_remove (&m->elem);
+  for (i = 0; i < m->page_cnt; i++)
+    page_deallocate (m->base + i * PGSIZE);
+
+  lock_acquire (&filesys_lock);
+  file_close (m->file);
+  lock_release (&filesys_lock);
+  free (m);
+}
+
+/* Mmap system call.  Maps the file open as FD at ADDR.  Pages
+   are read from the file when first touched, and only those
+   the process modifies are written back on munmap or exit. */
+static int
+sys_mmap (const uint32_t *args)
+{
+  struct thread *cur = thread_current ();
+  struct file *file = lookup_fd ((int) args[0]);
+  uint8_t *addr = (uint8_t *) args[1];
+  struct mapping *m;
+  off_t length;
+
+  if (file == NULL || addr == NULL || pg_ofs (addr) != 0
+      || !is_user_vaddr (addr))
+    return -1;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+
+  /* The mapping keeps its own file, so that it outlives FD. */
+  lock_acquire (&filesys_lock);
+  m->file = file_reopen (file);
+  length = m->file != NULL ? file_length (m->file) : 0;
+  lock_release (&filesys_lock);
+  if (m->file == NULL || length == 0
+      || (uintptr_t) length > (uintptr_t) PHYS_BASE - (uintptr_t) addr)
+    {
+      if (m->file != NULL)
+        {
+          lock_acquire (&filesys_lock);
+          file_close (m->file);
+          lock_release (&filesys_lock);
+        }
+      free (m);
+      return -1;
+    }
+
+  m->handle = cur->next_mapid++;
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&cur->mappings, &m->elem);
+
+  while (length > 0)
+    {
+      struct page *p = page_allocate (addr + m->page_cnt * PGSIZE, false);
+      if (p == NULL)
+        {
+          unmap (m);
+          return -1;
+        }
+      p->private = false;
+      p->file = m->file;
+      p->file_offset = m->page_cnt * PGSIZE;
+      p->file_bytes = length >= PGSIZE ? PGSIZE : length;
+      length -= p->file_bytes;
+      m->page_cnt++;
+    }
+
+  return m->handle;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (const uint32_t *args)
+{
+  struct thread *cur = thread_current ();
+  int handle = (int) args[0];
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->handle == handle)
+        {
+          unmap (m);
+          break;
+        }
+    }
+  return 0;
+}
+#endif
+
+/* Returns the file that FD refers to in the running process, or
+   a null pointer if FD is not open. */
+static struct file *
+lookup_fd (int fd)
+{
+  struct thread *cur = thread_current ();
+
+  if (fd < 2 || fd - 2 >= cur->fd_cnt)
+    return NULL;
+  return cur->fds[fd - 2];
+}
+
+/* Adds FILE to the running process's file descriptor table and
+   returns the lowest free descriptor for it, growing the table
+   if necessary.  Returns -1 if memory is exhausted. */
+static int
+install_fd (struct file *file)
+{
+  struct thread *cur = thread_current ();
+  struct file **fds;
+  int new_cnt;
+  int i;
+
+  for (i = 0; i < cur->fd_cnt; i++)
+    if (cur->fds[i] == NULL)
+      {
+        cur->fds[i] = file;
+        return i + 2;
+      }
+
+  new_cnt = cur->fd_cnt > 0 ? cur->fd_cnt * 2 : 8;
+  fds = realloc (cur->fds, sizeof *fds * new_cnt);
+  if (fds == NULL)
+    return -1;
+  memset (fds + cur->fd_cnt, 0, sizeof *fds * (new_cnt - cur->fd_cnt));
+  cur->fds = fds;
+  cur->fd_cnt = new_cnt;
+
+  fds[i] = file;
+  return i + 2;
+}
+
+/* On thread exit, unmaps all memory-mapped files, closes all
+   open file descriptors, and frees the exec buffer. */
+void
+syscall_exit (void)
+{
+  struct thread *cur = thread_current ();
+  int i;
+
+#ifdef VM
+  while (!list_empty (&cur->mappings))
+    unmap (list_entry (list_front (&cur->mappings),
+                       struct mapping, elem));
+#endif
+
+  palloc_free_page (cur->exec_buf);
+  cur->exec_buf = NULL;
+
+  if (cur->fds == NULL)
+    return;
+
+  lock_acquire (&filesys_lock);
+  for (i = 0; i < cur->fd_cnt; i++)
+    file_close (cur->fds[i]);
+  lock_release (&filesys_lock);
+
+  free (cur->fds);
+  cur->fds = NULL;
+  cur->fd_cnt = 0;
+}
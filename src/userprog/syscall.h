@@ -1,6 +1,13 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include "threads/synch.h"
+
+/* Serializes access to the file system, which does not do its
+   own locking. */
+extern struct lock filesys_lock;
+
 void syscall_init (void);
+void syscall_exit (void);
 
 #endif /* userprog/syscall.h */
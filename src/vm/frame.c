@@ -0,0 +1,480 @@
+#include "vm/frame.h"
+#include <stdio.h>
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Every frame in the user pool, claimed from palloc at boot. */
+static struct frame *frames;
+static size_t frame_cnt;
+
+/* Protects the fields below, and serializes frame allocation
+   and eviction.  Individual frames are protected by their own
+   locks, which allocation only ever tries to acquire, so it is
+   safe to wait for scan_lock while holding a frame lock. */
+static struct lock scan_lock;
+static size_t hand;             /* Clock hand, an index into frames. */
+static size_t free_cnt;         /* Number of frames without a page. */
+
+/* Share table: shared frames, keyed by the file data they
+   hold.
+
+   share_lock is acquired before scan_lock and is never held
+   while waiting for a frame lock, so a frame's lock may be held
+   while waiting for share_lock.  Eviction, which holds
+   scan_lock and a frame lock, only ever tries to acquire it. */
+static struct lock share_lock;
+static struct hash share_table;
+
+/* Statistics. */
+static size_t peak_cnt;         /* Most frames in use at once. */
+static long long evict_cnt;     /* Number of pages evicted. */
+static long long share_cnt;     /* Faults satisfied by a shared frame. */
+
+static hash_hash_func share_hash;
+static hash_less_func share_less;
+
+/* Initializes the frame manager, taking every page in the user
+   pool for the frame table. */
+void
+frame_init (void)
+{
+  void *base;
+
+  lock_init (&scan_lock);
+  lock_init (&share_lock);
+  hash_init (&share_table, share_hash, share_less, NULL);
+
+  frames = malloc (sizeof *frames * init_ram_pages);
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    {
+      struct frame *f = &frames[frame_cnt++];
+      lock_init (&f->lock);
+      f->base = base;
+      f->page = NULL;
+      f->shared = false;
+      list_init (&f->sharers);
+    }
+  free_cnt = frame_cnt;
+}
+
+/* Claims F, which must be locked and free or just evicted, for
+   PAGE.  The caller must hold scan_lock. */
+static struct frame *
+claim_frame (struct frame *f, struct page *page)
+{
+  ASSERT (!f->shared);
+  f->page = page;
+  if (frame_cnt - free_cnt > peak_cnt)
+    peak_cnt = frame_cnt - free_cnt;
+  lock_release (&scan_lock);
+  return f;
+}
+
+/* Tries to evict shared frame F, which must be locked, by
+   unmapping it from every page that shares it.  Fails if the
+   share table is busy or if any sharer accessed F recently.
+   The caller must hold scan_lock. */
+static bool
+evict_shared (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  if (!lock_try_acquire (&share_lock))
+    return false;
+
+  /* Check, and clear, every sharer's accessed bit. */
+  for (e = list_begin (&f->sharers); e != list_end (&f->sharers);
+       e = list_next (e))
+    if (page_accessed_recently (list_entry (e, struct page, share_elem)))
+      accessed = true;
+
+  if (!accessed)
+    {
+      /* Shared frames are mapped read-only, so they are never
+         dirty and page_out() always evicts them. */
+      while (!list_empty (&f->sharers))
+        {
+          struct page *p = list_entry (list_pop_front (&f->sharers),
+                                       struct page, share_elem);
+          page_out (p);
+        }
+      hash_delete (&share_table, &f->share_elem);
+      f->shared = false;
+    }
+
+  lock_release (&share_lock);
+  return !accessed;
+}
+
+/* Restores the mappings of the CNT dirty frames in CLUSTER,
+   which were unmapped for writing to swap, and unlocks them. */
+static void
+cancel_cluster (struct frame **cluster, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      page_out_cancel (cluster[i]->page);
+      lock_release (&cluster[i]->lock);
+    }
+}
+
+/* Writes the pages in the CNT dirty frames in CLUSTER, which
+   must be locked and unmapped, to swap in a single request.
+   Claims the first frame for PAGE and frees the others, so that
+   the next few faults find free frames without evicting.
+   Returns the claimed frame, or a null pointer if swap is full.
+   The caller must hold scan_lock.
+
+   scan_lock is released during the write, so that other threads
+   can allocate frames meanwhile.  The frames stay locked, which
+   keeps eviction away from them and makes a fault on one of
+   their pages wait until the write is done. */
+static struct frame *
+swap_out_cluster (struct frame **cluster, size_t cnt, struct page *page)
+{
+  struct page *pages[SWAP_CLUSTER];
+  size_t written, i;
+
+  for (i = 0; i < cnt; i++)
+    pages[i] = cluster[i]->page;
+  written = swap_reserve (pages, cnt);
+  cancel_cluster (cluster + written, cnt - written);
+  if (written == 0)
+    return NULL;
+
+  lock_release (&scan_lock);
+  swap_out (pages, written);
+  lock_acquire (&scan_lock);
+
+  evict_cnt += written;
+  for (i = 0; i < written; i++)
+    pages[i]->frame = NULL;
+  for (i = 1; i < written; i++)
+    {
+      cluster[i]->page = NULL;
+      free_cnt++;
+      lock_release (&cluster[i]->lock);
+    }
+  return claim_frame (cluster[0], page);
+}
+
+/* Tries to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+static struct frame *
+try_frame_alloc_and_lock (struct page *page)
+{
+  struct frame *cluster[SWAP_CLUSTER];
+  size_t cluster_cnt = 0;
+  size_t i;
+
+  lock_acquire (&scan_lock);
+
+  /* Find a free frame, if there is one. */
+  if (free_cnt > 0)
+    for (i = 0; i < frame_cnt; i++)
+      {
+        struct frame *f = &frames[i];
+        if (!lock_try_acquire (&f->lock))
+          continue;
+        if (f->page == NULL && !f->shared)
+          {
+            free_cnt--;
+            return claim_frame (f, page);
+          }
+        lock_release (&f->lock);
+      }
+
+  /* No free frame.  Sweep the clock hand over the frames twice
+     at most: the first pass clears the accessed bits that the
+     second may then find still clear.  A victim that can simply
+     be dropped is taken at once.  Dirty victims are gathered
+     until there are enough to write to swap together. */
+  for (i = 0; i < frame_cnt * 2 && cluster_cnt < SWAP_CLUSTER; i++)
+    {
+      struct frame *f = &frames[hand];
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      /* Skip frames that are busy, including those already
+         gathered for swap on the second pass. */
+      if (lock_held_by_current_thread (&f->lock)
+          || !lock_try_acquire (&f->lock))
+        continue;
+
+      if (f->shared)
+        {
+          if (!evict_shared (f))
+            {
+              lock_release (&f->lock);
+              continue;
+            }
+          cancel_cluster (cluster, cluster_cnt);
+          evict_cnt++;
+          return claim_frame (f, page);
+        }
+
+      if (f->page == NULL)
+        {
+          cancel_cluster (cluster, cluster_cnt);
+          free_cnt--;
+          return claim_frame (f, page);
+        }
+
+      if (page_accessed_recently (f->page))
+        {
+          lock_release (&f->lock);
+          continue;
+        }
+
+      /* Evict this frame, or save it for writing to swap. */
+      switch (page_out (f->page))
+        {
+        case PAGE_EVICTED:
+          break;
+        case PAGE_NEEDS_SWAP:
+          cluster[cluster_cnt++] = f;
+          continue;
+        case PAGE_KEPT:
+          lock_release (&f->lock);
+          continue;
+        }
+      cancel_cluster (cluster, cluster_cnt);
+      evict_cnt++;
+      return claim_frame (f, page);
+    }
+
+  if (cluster_cnt > 0)
+    {
+      struct frame *f = swap_out_cluster (cluster, cluster_cnt, page);
+      if (f != NULL)
+        return f;
+    }
+
+  lock_release (&scan_lock);
+  return NULL;
+}
+
+/* Tries really hard to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+struct frame *
+frame_alloc_and_lock (struct page *page)
+{
+  size_t try;
+
+  for (try = 0; try < 3; try++)
+    {
+      struct frame *f = try_frame_alloc_and_lock (page);
+      if (f != NULL)
+        {
+          ASSERT (lock_held_by_current_thread (&f->lock));
+          return f;
+        }
+      timer_msleep (1000);
+    }
+
+  return NULL;
+}
+
+/* Locks P's frame into memory, if it has one.
+   Upon return, p->frame will not change until P is unlocked. */
+void
+frame_lock (struct page *p)
+{
+  /* A frame can be asynchronously removed, but never inserted. */
+  struct frame *f = p->frame;
+  if (f != NULL)
+    {
+      lock_acquire (&f->lock);
+      if (f != p->frame)
+        {
+          lock_release (&f->lock);
+          ASSERT (p->frame == NULL);
+        }
+    }
+}
+
+/* Releases frame F for use by another page.
+   F must be locked for use by the current process.
+   Any data in F is lost. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  lock_acquire (&scan_lock);
+  f->page = NULL;
+  free_cnt++;
+  lock_release (&scan_lock);
+  lock_release (&f->lock);
+}
+
+/* Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current process. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  lock_release (&f->lock);
+}
+
+/* Looks in the share table for a frame that holds the file
+   data of page P, which must not have a frame.  If there is one,
+   adds P to its sharers and returns true.  P's frame is then
+   locked with frame_lock(), but it may be evicted first, leaving
+   P without a frame again.  Returns false if there is no such
+   frame. */
+bool
+frame_share_lookup (struct page *p)
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  ASSERT (p->frame == NULL);
+  ASSERT (p->file != NULL);
+
+  key.inode = file_get_inode (p->file);
+  key.file_offset = p->file_offset;
+  key.file_bytes = p->file_bytes;
+
+  lock_acquire (&share_lock);
+  e = hash_find (&share_table, &key.share_elem);
+  if (e != NULL)
+    {
+      struct frame *f = hash_entry (e, struct frame, share_elem);
+      list_push_back (&f->sharers, &p->share_elem);
+      p->frame = f;
+      share_cnt++;
+    }
+  lock_release (&share_lock);
+
+  if (e == NULL)
+    return false;
+  frame_lock (p);
+  return true;
+}
+
+/* Offers the frame of page P, which must be locked and hold P's
+   file data, to the share table.  If another process added a
+   frame with the same data first, P joins that frame instead and
+   its own frame is freed.  Either way, P's frame is locked on
+   return unless it was evicted in the meantime, in which case P
+   has no frame. */
+void
+frame_share_insert (struct page *p)
+{
+  struct frame *f = p->frame;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->page == p && !f->shared);
+
+  f->inode = file_get_inode (p->file);
+  f->file_offset = p->file_offset;
+  f->file_bytes = p->file_bytes;
+
+  /* F is not yet in the share table, so no thread holding
+     share_lock can be waiting for its lock. */
+  lock_acquire (&share_lock);
+  e = hash_insert (&share_table, &f->share_elem);
+  if (e == NULL)
+    {
+      f->page = NULL;
+      f->shared = true;
+      list_push_back (&f->sharers, &p->share_elem);
+      lock_release (&share_lock);
+      return;
+    }
+  else
+    {
+      struct frame *g = hash_entry (e, struct frame, share_elem);
+      list_push_back (&g->sharers, &p->share_elem);
+      p->frame = g;
+      share_cnt++;
+      lock_release (&share_lock);
+
+      frame_free (f);
+      frame_lock (p);
+    }
+}
+
+/* If page P, which must belong to the current process, has a
+   shared frame, removes P from its sharers, unmaps it, and
+   returns true.  The frame is freed when its last sharer leaves.
+   Returns false, doing nothing, if P has no frame or a frame of
+   its own. */
+bool
+frame_share_release (struct page *p)
+{
+  struct frame *f;
+
+  lock_acquire (&share_lock);
+  f = p->frame;
+  if (f == NULL || !f->shared)
+    {
+      lock_release (&share_lock);
+      return false;
+    }
+
+  list_remove (&p->share_elem);
+  pagedir_clear_page (p->thread->pagedir, p->addr);
+  p->frame = NULL;
+  if (list_empty (&f->sharers))
+    {
+      hash_delete (&share_table, &f->share_elem);
+      lock_acquire (&scan_lock);
+      f->shared = false;
+      free_cnt++;
+      lock_release (&scan_lock);
+    }
+  lock_release (&share_lock);
+  return true;
+}
+
+/* Returns a hash value for shared frame E. */
+static unsigned
+share_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, share_elem);
+  return (hash_bytes (&f->inode, sizeof f->inode)
+          ^ hash_int (f->file_offset) ^ hash_int (f->file_bytes));
+}
+
+/* Returns true if shared frame A's key precedes B's. */
+static bool
+share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, share_elem);
+  const struct frame *b = hash_entry (b_, struct frame, share_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  else if (a->file_offset != b->file_offset)
+    return a->file_offset < b->file_offset;
+  else
+    return a->file_bytes < b->file_bytes;
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %zu total, %zu peak in use, %lld evictions, "
+          "%lld shared faults\n",
+          frame_cnt, peak_cnt, evict_cnt, share_cnt);
+}
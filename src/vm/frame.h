@@ -0,0 +1,45 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+/* A physical frame.
+
+   A frame either belongs to a single process page, PAGE, or is
+   shared: it holds file data that any number of processes map
+   read-only, and is found through the share table by the file's
+   inode and the offset and length of the data.  The members
+   below SHARED are protected by the share table's lock. */
+struct frame
+  {
+    struct lock lock;           /* Prevent simultaneous access. */
+    void *base;                 /* Kernel virtual base address. */
+    struct page *page;          /* Mapped process page, if any. */
+
+    bool shared;                /* In the share table? */
+    struct list sharers;        /* Pages mapping a shared frame. */
+    struct hash_elem share_elem; /* Share table element. */
+    struct inode *inode;        /* Key: inode holding the data. */
+    off_t file_offset;          /* Key: offset of the data. */
+    off_t file_bytes;           /* Key: bytes of data, 1...PGSIZE. */
+  };
+
+void frame_init (void);
+
+struct frame *frame_alloc_and_lock (struct page *);
+void frame_lock (struct page *);
+
+void frame_free (struct frame *);
+void frame_unlock (struct frame *);
+
+bool frame_share_lookup (struct page *);
+void frame_share_insert (struct page *);
+bool frame_share_release (struct page *);
+
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,455 @@
+#include "vm/page.h"
+#include <bitmap.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+
+/* Maximum size of a process's stack, in bytes.
+   Controlled by kernel command-line option "-stack=MB". */
+size_t page_stack_max = 8 * 1024 * 1024;
+
+/* Writes memory-mapped page P's frame, which must be locked,
+   back to P's file.  If WAIT is false and another thread holds
+   filesys_lock, gives up instead of waiting for it.
+   Returns true if successful, false on failure. */
+static bool
+write_back (struct page *p, bool wait)
+{
+  bool held = lock_held_by_current_thread (&filesys_lock);
+  off_t written;
+
+  ASSERT (!p->private && p->file != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  if (!held)
+    {
+      if (wait)
+        lock_acquire (&filesys_lock);
+      else if (!lock_try_acquire (&filesys_lock))
+        return false;
+    }
+  written = file_write_at (p->file, p->frame->base,
+                           p->file_bytes, p->file_offset);
+  if (!held)
+    lock_release (&filesys_lock);
+  return written == p->file_bytes;
+}
+
+/* Releases page P's frame and swap slot and frees P, writing its
+   data back to its file first if it is a modified memory-mapped
+   page.  P must belong to the current process and must already
+   be removed from its page table. */
+static void
+free_page (struct page *p)
+{
+  if (!frame_share_release (p))
+    {
+      frame_lock (p);
+      if (p->frame != NULL)
+        {
+          uint32_t *pd = p->thread->pagedir;
+
+          pagedir_clear_page (pd, p->addr);
+          if (!p->private && pagedir_is_dirty (pd, p->addr))
+            write_back (p, true);
+          frame_free (p->frame);
+        }
+    }
+  swap_free (p);
+  free (p);
+}
+
+/* Destroys a page, which must be in the current process's
+   page table.  Used as a callback for hash_destroy(). */
+static void
+destroy_page (struct hash_elem *p_, void *aux UNUSED)
+{
+  free_page (hash_entry (p_, struct page, hash_elem));
+}
+
+/* Destroys the current process's page table, releasing its
+   frames.  Must be called before the process's page directory
+   is destroyed, so that the frames are not freed twice. */
+void
+page_exit (void)
+{
+  struct thread *t = thread_current ();
+  if (t->pages != NULL)
+    {
+      hash_destroy (t->pages, destroy_page);
+      free (t->pages);
+      t->pages = NULL;
+    }
+}
+
+/* Returns true if an access to user virtual address ADDRESS,
+   which has no page, should grow the current process's stack.
+   The access must lie within page_stack_max bytes of PHYS_BASE
+   and no more than 32 bytes below the user stack pointer, the
+   most that PUSHA writes below it before %esp moves. */
+static bool
+is_stack_growth (const void *address)
+{
+  const uint8_t *esp = thread_current ()->user_esp;
+  uintptr_t depth = (uintptr_t) PHYS_BASE - (uintptr_t) address;
+
+  return (depth <= page_stack_max
+          && esp != NULL && (const uint8_t *) address >= esp - 32);
+}
+
+/* Returns the page containing the given virtual ADDRESS,
+   or a null pointer if no such page exists.  An access just
+   below the stack grows it by a page, which stays zero-filled
+   and costs no frame until it is touched. */
+static struct page *
+page_for_addr (const void *address)
+{
+  if (address < PHYS_BASE)
+    {
+      struct page p;
+      struct hash_elem *e;
+
+      p.addr = (void *) pg_round_down (address);
+      e = hash_find (thread_current ()->pages, &p.hash_elem);
+      if (e != NULL)
+        return hash_entry (e, struct page, hash_elem);
+
+      if (is_stack_growth (address))
+        return page_allocate (p.addr, false);
+    }
+  return NULL;
+}
+
+/* Locks a frame of its own for page P and pages it in.
+   Returns true if successful, false on failure. */
+static bool
+private_page_in (struct page *p)
+{
+  /* Get a frame for the page. */
+  p->frame = frame_alloc_and_lock (p);
+  if (p->frame == NULL)
+    return false;
+
+  /* Copy data into the frame.  A fault may arrive while the
+     faulting thread already holds filesys_lock, for example
+     while a system call touches the user buffer it was passed. */
+  if (p->swap_slot != BITMAP_ERROR)
+    swap_in (p);
+  else if (p->file != NULL)
+    {
+      bool held = lock_held_by_current_thread (&filesys_lock);
+      off_t read_bytes;
+
+      if (!held)
+        lock_acquire (&filesys_lock);
+      read_bytes = file_read_at (p->file, p->frame->base,
+                                 p->file_bytes, p->file_offset);
+      if (!held)
+        lock_release (&filesys_lock);
+
+      if (read_bytes != p->file_bytes)
+        {
+          frame_free (p->frame);
+          p->frame = NULL;
+          return false;
+        }
+      memset ((uint8_t *) p->frame->base + read_bytes, 0,
+              PGSIZE - read_bytes);
+    }
+  else
+    memset (p->frame->base, 0, PGSIZE);
+
+  return true;
+}
+
+/* Locks a frame for page P and pages it in.  If P's file data
+   may be shared, P has not been swapped out, and WRITE is false,
+   the frame is shared with any other process that has the same
+   data paged in.
+   Returns true if successful, false on failure. */
+static bool
+do_page_in (struct page *p, bool write)
+{
+  if (!p->sharable || write || p->swap_slot != BITMAP_ERROR)
+    return private_page_in (p);
+
+  /* Either step may lose the frame to eviction before we lock
+     it, so keep trying until we have one. */
+  while (p->frame == NULL)
+    if (!frame_share_lookup (p))
+      {
+        if (!private_page_in (p))
+          return false;
+        frame_share_insert (p);
+      }
+  return true;
+}
+
+/* Gives page P, which must have a locked shared frame, a frame
+   of its own holding a copy of the shared frame's data, and
+   locks it in place of the shared frame.  This is the
+   copy-on-write of a writable page that was shared until now.
+   Returns true if successful, false on failure. */
+static bool
+unshare_page (struct page *p)
+{
+  struct frame *shared = p->frame;
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&shared->lock));
+  ASSERT (shared->shared && !p->read_only);
+
+  /* The shared frame stays locked, so it cannot be evicted
+     while we copy it. */
+  f = frame_alloc_and_lock (p);
+  if (f == NULL)
+    {
+      frame_unlock (shared);
+      return false;
+    }
+  memcpy (f->base, shared->base, PGSIZE);
+
+  frame_share_release (p);
+  frame_unlock (shared);
+  p->frame = f;
+  return true;
+}
+
+/* Maps P's frame, which must be locked, into the current
+   process's page table.  A shared frame is mapped read-only, so
+   that the first write to it faults. */
+static bool
+map_frame (struct page *p)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Already mapped, e.g. if the fault raced with a failed
+     eviction that restored the mapping. */
+  if (pagedir_get_page (pd, p->addr) != NULL)
+    return true;
+
+  return pagedir_set_page (pd, p->addr, p->frame->base,
+                           !p->read_only && !p->frame->shared);
+}
+
+/* Brings page P into memory, writable if WRITE is true, and
+   returns with its frame locked and mapped.
+   Returns true if successful, false on failure. */
+static bool
+page_in_locked (struct page *p, bool write)
+{
+  if (write && p->read_only)
+    return false;
+
+  frame_lock (p);
+  if (p->frame == NULL)
+    {
+      if (!do_page_in (p, write))
+        return false;
+    }
+  else if (write && p->frame->shared)
+    {
+      if (!unshare_page (p))
+        return false;
+    }
+
+  if (!map_frame (p))
+    {
+      frame_unlock (p->frame);
+      return false;
+    }
+  return true;
+}
+
+/* Faults in the page containing FAULT_ADDR, for writing if
+   WRITE is true.
+   Returns true if successful, false on failure. */
+bool
+page_in (void *fault_addr, bool write)
+{
+  struct page *p;
+
+  /* Can't handle page faults without a hash table. */
+  if (thread_current ()->pages == NULL)
+    return false;
+
+  p = page_for_addr (fault_addr);
+  if (p == NULL || !page_in_locked (p, write))
+    return false;
+
+  /* Release frame. */
+  frame_unlock (p->frame);
+  return true;
+}
+
+/* Evicts page P.
+   P must have a locked frame.
+   Returns PAGE_EVICTED if successful.  Returns PAGE_NEEDS_SWAP if
+   P is a dirty private page, leaving it unmapped, so that the
+   caller can write it to swap with swap_out() or else restore it
+   with page_out_cancel().  Returns PAGE_KEPT, leaving P mapped,
+   if P is a dirty memory-mapped page that cannot be written back
+   to its file right now. */
+enum page_out_result
+page_out (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Mark page not present in page table, forcing accesses by the
+     process to fault.  This must happen before checking the
+     dirty bit, to prevent a race with the process dirtying the
+     page. */
+  pagedir_clear_page (pd, p->addr);
+
+  /* A clean page can simply be dropped: it is read back from
+     swap or its file, or zeroed again, when next touched.  A
+     modified private page's old swap slot, if any, is now stale.
+     A modified memory-mapped page goes back to its file, which
+     must not wait for filesys_lock: its holder may be faulting
+     and waiting for this very eviction. */
+  if (pagedir_is_dirty (pd, p->addr))
+    {
+      if (p->private)
+        {
+          swap_free (p);
+          return PAGE_NEEDS_SWAP;
+        }
+      if (!write_back (p, false))
+        {
+          page_out_cancel (p);
+          return PAGE_KEPT;
+        }
+    }
+
+  p->frame = NULL;
+  return PAGE_EVICTED;
+}
+
+/* Restores the mapping of page P, which page_out() refused to
+   evict because it is dirty.  P must have a locked frame. */
+void
+page_out_cancel (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  if (pagedir_set_page (pd, p->addr, p->frame->base, !p->read_only))
+    pagedir_set_dirty (pd, p->addr, true);
+}
+
+/* Returns true if page P's data has been accessed recently,
+   false otherwise.
+   P must have a frame locked into memory. */
+bool
+page_accessed_recently (struct page *p)
+{
+  bool was_accessed;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  was_accessed = pagedir_is_accessed (p->thread->pagedir, p->addr);
+  if (was_accessed)
+    pagedir_set_accessed (p->thread->pagedir, p->addr, false);
+  return was_accessed;
+}
+
+/* Adds a mapping for user virtual address VADDR to the page hash
+   table.  The page is zero-filled until its file fields are set.
+   Fails if VADDR is already mapped or if memory allocation
+   fails. */
+struct page *
+page_allocate (void *vaddr, bool read_only)
+{
+  struct thread *t = thread_current ();
+  struct page *p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      p->addr = pg_round_down (vaddr);
+      p->read_only = read_only;
+      p->thread = t;
+
+      p->frame = NULL;
+
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+      p->sharable = false;
+      p->private = true;
+      p->swap_slot = BITMAP_ERROR;
+
+      if (hash_insert (t->pages, &p->hash_elem) != NULL)
+        {
+          /* Already mapped. */
+          free (p);
+          p = NULL;
+        }
+    }
+  return p;
+}
+
+/* Removes the current process's mapping for the page containing
+   user virtual address VADDR, which must exist.  A modified
+   memory-mapped page is written back to its file first. */
+void
+page_deallocate (void *vaddr)
+{
+  struct page *p = page_for_addr (vaddr);
+  ASSERT (p != NULL);
+  hash_delete (thread_current ()->pages, &p->hash_elem);
+  free_page (p);
+}
+
+/* Returns a hash value for the page that E refers to. */
+unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return ((uintptr_t) p->addr) >> PGBITS;
+}
+
+/* Returns true if page A precedes page B. */
+bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->addr < b->addr;
+}
+
+/* Tries to lock the page containing ADDR into physical memory.
+   If WILL_WRITE is true, the page must be writeable;
+   otherwise it may be read-only.
+   Returns true if successful, false on failure. */
+bool
+page_lock (const void *addr, bool will_write)
+{
+  struct page *p = page_for_addr (addr);
+  return p != NULL && page_in_locked (p, will_write);
+}
+
+/* Unlocks a page locked with page_lock(). */
+void
+page_unlock (const void *addr)
+{
+  struct page *p = page_for_addr (addr);
+  ASSERT (p != NULL);
+  frame_unlock (p->frame);
+}
@@ -0,0 +1,72 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+/* Virtual page. */
+struct page
+  {
+    /* Immutable members. */
+    void *addr;                 /* User virtual address. */
+    bool read_only;             /* Read-only page? */
+    struct thread *thread;      /* Owning thread. */
+
+    /* Accessed only in owning process context. */
+    struct hash_elem hash_elem; /* struct thread `pages' hash element. */
+
+    /* Set only in owning process context with frame->lock held,
+       or with the share table's lock held for a shared frame.
+       Cleared only with scan_lock and frame->lock held, or in
+       owning process context with the share table's lock held. */
+    struct frame *frame;        /* Page frame. */
+    struct list_elem share_elem; /* Shared frame's `sharers' element. */
+
+    /* Memory-mapped file information, protected by frame->lock.
+       If FILE is null, the page is zero-filled. */
+    struct file *file;          /* File. */
+    off_t file_offset;          /* Offset in file. */
+    off_t file_bytes;           /* Bytes to read, 1...PGSIZE. */
+    bool sharable;              /* Share FILE's data read-only with
+                                   other processes until written? */
+    bool private;               /* False to write back to FILE,
+                                   true to write back to swap. */
+
+    /* Swap information, protected by frame->lock while the page
+       has a frame.  A page with a swap slot is read from it in
+       preference to FILE.  The slot stays valid until the page
+       is modified. */
+    size_t swap_slot;           /* Swap slot, or BITMAP_ERROR. */
+  };
+
+/* Maximum size of a process's stack, in bytes. */
+extern size_t page_stack_max;
+
+/* How page_out() leaves a page. */
+enum page_out_result
+  {
+    PAGE_EVICTED,               /* Evicted; its frame may be reused. */
+    PAGE_NEEDS_SWAP,            /* Dirty and unmapped, for swap_out(). */
+    PAGE_KEPT                   /* Not evicted, still mapped. */
+  };
+
+void page_exit (void);
+
+struct page *page_allocate (void *, bool read_only);
+void page_deallocate (void *);
+
+bool page_in (void *fault_addr, bool write);
+enum page_out_result page_out (struct page *);
+void page_out_cancel (struct page *);
+bool page_accessed_recently (struct page *);
+
+bool page_lock (const void *, bool will_write);
+void page_unlock (const void *);
+
+hash_hash_func page_hash;
+hash_less_func page_less;
+
+#endif /* vm/page.h */
@@ -0,0 +1,147 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "devices/block.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* The swap device. */
+static struct block *swap_device;
+
+/* Used swap slots, one bit per page-sized slot. */
+static struct bitmap *swap_map;
+
+/* Protects swap_map. */
+static struct lock swap_lock;
+
+/* Buffer of SWAP_CLUSTER contiguous pages through which
+   swap_out() writes, and the lock that protects it.  Evicting
+   threads write without holding the frame table's lock, so more
+   than one may be writing at once. */
+static uint8_t *cluster_buf;
+static struct lock cluster_lock;
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Statistics. */
+static long long write_cnt;     /* Pages written. */
+static long long request_cnt;   /* Write requests. */
+static long long read_cnt;      /* Pages read. */
+
+/* Sets up swap, if there is a swap device. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  lock_init (&cluster_lock);
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("no swap device--swap disabled\n");
+      swap_map = bitmap_create (0);
+    }
+  else
+    swap_map = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  if (swap_map == NULL)
+    PANIC ("couldn't create swap bitmap");
+  cluster_buf = palloc_get_multiple (PAL_ASSERT, SWAP_CLUSTER);
+}
+
+/* Gives the first of the CNT pages in PAGES, and as many of the
+   rest as fit, consecutive free swap slots.  Returns the number
+   of pages given slots, or 0 if swap is full.  Each page must
+   have a locked frame that is already unmapped from its process,
+   and must then be written with swap_out(). */
+size_t
+swap_reserve (struct page **pages, size_t cnt)
+{
+  size_t slot = BITMAP_ERROR;
+  size_t i;
+
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  /* Find the longest run of free slots we can use. */
+  lock_acquire (&swap_lock);
+  for (; cnt > 0; cnt--)
+    {
+      slot = bitmap_scan_and_flip (swap_map, 0, cnt, false);
+      if (slot != BITMAP_ERROR)
+        break;
+    }
+  lock_release (&swap_lock);
+
+  for (i = 0; i < cnt; i++)
+    {
+      ASSERT (lock_held_by_current_thread (&pages[i]->frame->lock));
+      ASSERT (pages[i]->swap_slot == BITMAP_ERROR);
+      pages[i]->swap_slot = slot + i;
+    }
+  return cnt;
+}
+
+/* Writes the data of the CNT pages in PAGES, which
+   swap_reserve() gave consecutive slots, to swap in a single
+   request.  The pages keep their locked frames, which the
+   caller may reuse once this function returns. */
+void
+swap_out (struct page **pages, size_t cnt)
+{
+  size_t i;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+
+  lock_acquire (&cluster_lock);
+  for (i = 0; i < cnt; i++)
+    {
+      ASSERT (lock_held_by_current_thread (&pages[i]->frame->lock));
+      ASSERT (pages[i]->swap_slot == pages[0]->swap_slot + i);
+      memcpy (cluster_buf + i * PGSIZE, pages[i]->frame->base, PGSIZE);
+    }
+  block_write_multiple (swap_device, pages[0]->swap_slot * PAGE_SECTORS,
+                        cnt * PAGE_SECTORS, cluster_buf);
+  write_cnt += cnt;
+  request_cnt++;
+  lock_release (&cluster_lock);
+}
+
+/* Reads page P's data from its swap slot into its frame, which
+   must be locked.  P keeps the slot, which holds a valid copy of
+   its data until P is next modified. */
+void
+swap_in (struct page *p)
+{
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->swap_slot != BITMAP_ERROR);
+
+  block_read_multiple (swap_device, p->swap_slot * PAGE_SECTORS,
+                       PAGE_SECTORS, p->frame->base);
+  read_cnt++;
+}
+
+/* Releases page P's swap slot, if it has one. */
+void
+swap_free (struct page *p)
+{
+  if (p->swap_slot != BITMAP_ERROR)
+    {
+      lock_acquire (&swap_lock);
+      bitmap_reset (swap_map, p->swap_slot);
+      lock_release (&swap_lock);
+      p->swap_slot = BITMAP_ERROR;
+    }
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %lld pages written in %lld requests, %lld pages read\n",
+          write_cnt, request_cnt, read_cnt);
+}
@@ -0,0 +1,19 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+
+/* Most pages that swap_out() writes in a single request. */
+#define SWAP_CLUSTER 8
+
+void swap_init (void);
+size_t swap_reserve (struct page **, size_t cnt);
+void swap_out (struct page **, size_t cnt);
+void swap_in (struct page *);
+void swap_free (struct page *);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */